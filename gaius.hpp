@@ -0,0 +1,203 @@
+/*
+    Gaius - A cryptography tool which implements a new complex mixed substitution
+    cipher dubbed 'Gaius Cipher' into binary/plaintext data structures.
+
+    Created by Adrian Tarver(Th3Tr1ckst3r) @ https://github.com/Th3Tr1ckst3r/
+
+////////////////////////////////////////////////////////////////////////////////////////
+
+  Header-only C++20 interface to the Gaius cipher core, for programs that want to
+  cipher buffers in-process instead of running the gaius binary. Output is byte for
+  byte what gaius_v1.1.c produces for a single chunk, so a file written with
+  "-chunk N" can be processed by feeding this class N-byte chunks (or the matching
+  enciphered chunk size when deciphering Base64 output).
+
+  No function here allocates. The keyword dependent substitution table is built in
+  the constructor, everything else is generated at compile time.
+
+  Licensed under the same terms as the rest of Gaius:
+  https://raw.githubusercontent.com/Th3Tr1ckst3r/Gaius/main/LICENSE
+*/
+
+#ifndef GAIUS_HPP
+#define GAIUS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace gaius {
+
+enum class direction { encipher, decipher };
+enum class encoding { base64, none };
+
+namespace detail {
+
+inline constexpr std::string_view alphabet = "abcdefghijklmnopqrstuvwxyz";
+inline constexpr std::string_view b64_table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Marks bytes that are not part of a lookup table.
+inline constexpr std::uint8_t no_index = 0xFF;
+
+// Reverse lookup of ALPHABET, lower and upper case both map to 0-25.
+constexpr std::array<std::uint8_t, 256> make_alphabet_index() {
+    std::array<std::uint8_t, 256> index{};
+    for (auto &entry : index) entry = no_index;
+    for (std::size_t i = 0; i < alphabet.size(); i++) {
+        index[static_cast<unsigned char>(alphabet[i])] = static_cast<std::uint8_t>(i);
+        index[static_cast<unsigned char>(alphabet[i] - 'a' + 'A')] = static_cast<std::uint8_t>(i);
+    }
+    return index;
+}
+
+// Reverse lookup of the Base64 table, '=' and invalid characters decode as 0.
+constexpr std::array<std::uint8_t, 256> make_b64_index() {
+    std::array<std::uint8_t, 256> index{};
+    for (std::size_t i = 0; i < b64_table.size(); i++) {
+        index[static_cast<unsigned char>(b64_table[i])] = static_cast<std::uint8_t>(i);
+    }
+    return index;
+}
+
+inline constexpr auto alphabet_index = make_alphabet_index();
+inline constexpr auto b64_index = make_b64_index();
+
+static_assert(alphabet_index['q'] == 16 && alphabet_index['Q'] == 16 && alphabet_index['!'] == no_index);
+static_assert(b64_index['A'] == 0 && b64_index['/'] == 63);
+
+constexpr char to_upper(char ch) {
+    return (ch >= 'a' && ch <= 'z') ? static_cast<char>(ch - 'a' + 'A') : ch;
+}
+
+} // namespace detail
+
+// Mixed alphabet derived from a keyword, identical to generate_mixed_alphabet() in the C tool.
+constexpr std::array<char, 26> mixed_alphabet(std::string_view keyword) {
+    std::array<char, 26> mixed{};
+    std::array<bool, 26> used{};
+    std::size_t j = 0;
+
+    for (char ch : keyword) {
+        std::uint8_t index = detail::alphabet_index[static_cast<unsigned char>(ch)];
+        if (index != detail::no_index && !used[index]) {
+            mixed[j++] = detail::alphabet[index];
+            used[index] = true;
+        }
+    }
+    for (std::size_t i = 0; i < 26; i++) {
+        if (!used[i]) mixed[j++] = detail::alphabet[i];
+    }
+    return mixed;
+}
+
+// A keyed Gaius cipher. Direction and encoding are template parameters, so every
+// combination compiles to its own loop with no per-byte mode checks.
+template <direction Dir, encoding Enc = encoding::base64>
+class Cipher {
+public:
+    // Returned by process() when the output span is too small.
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    constexpr explicit Cipher(std::string_view keyword) noexcept {
+        const auto mixed = mixed_alphabet(keyword);
+
+        // Byte substitution, letters keep their case and everything else passes through
+        for (std::size_t i = 0; i < 256; i++) table_[i] = static_cast<std::uint8_t>(i);
+        for (std::size_t i = 0; i < 26; i++) {
+            char from = Dir == direction::encipher ? mixed[i] : detail::alphabet[i];
+            char to = Dir == direction::encipher ? detail::alphabet[i] : mixed[i];
+            table_[static_cast<unsigned char>(from)] = static_cast<std::uint8_t>(to);
+            table_[static_cast<unsigned char>(detail::to_upper(from))] = static_cast<std::uint8_t>(detail::to_upper(to));
+        }
+
+        // Fold the substitution into the Base64 tables so each path is a single lookup per symbol
+        if constexpr (Enc == encoding::base64) {
+            for (std::size_t i = 0; i < 64; i++) {
+                encode_table_[i] = table_[static_cast<unsigned char>(detail::b64_table[i])];
+            }
+            for (std::size_t i = 0; i < 256; i++) {
+                decode_table_[i] = detail::b64_index[table_[i]];
+            }
+        }
+    }
+
+    // Upper bound of the output size for an input chunk of the given size.
+    static constexpr std::size_t output_size(std::size_t input_size) noexcept {
+        if constexpr (Enc == encoding::none) {
+            return input_size;
+        } else if constexpr (Dir == direction::encipher) {
+            return 4 * ((input_size + 2) / 3);
+        } else {
+            return input_size / 4 * 3;
+        }
+    }
+
+    // Processes one chunk. Returns the number of bytes written, or npos if out is smaller than output_size().
+    std::size_t process(std::span<const std::byte> in, std::span<std::byte> out) const noexcept {
+        if (out.size() < output_size(in.size())) {
+            return npos;
+        }
+        const auto *src = reinterpret_cast<const std::uint8_t *>(in.data());
+        auto *dst = reinterpret_cast<std::uint8_t *>(out.data());
+
+        if constexpr (Enc == encoding::none) {
+            for (std::size_t i = 0; i < in.size(); i++) {
+                dst[i] = table_[src[i]];
+            }
+            return in.size();
+        } else if constexpr (Dir == direction::encipher) {
+            return encode(src, in.size(), dst);
+        } else {
+            return decode(src, in.size(), dst);
+        }
+    }
+
+private:
+    std::size_t encode(const std::uint8_t *src, std::size_t len, std::uint8_t *dst) const noexcept {
+        std::size_t i = 0, j = 0;
+        for (; i + 3 <= len; i += 3) {
+            std::uint32_t triple = (std::uint32_t{src[i]} << 16) | (std::uint32_t{src[i + 1]} << 8) | src[i + 2];
+            dst[j++] = encode_table_[(triple >> 18) & 0x3F];
+            dst[j++] = encode_table_[(triple >> 12) & 0x3F];
+            dst[j++] = encode_table_[(triple >> 6) & 0x3F];
+            dst[j++] = encode_table_[triple & 0x3F];
+        }
+        if (std::size_t rest = len - i) {
+            std::uint32_t triple = std::uint32_t{src[i]} << 16;
+            if (rest == 2) triple |= std::uint32_t{src[i + 1]} << 8;
+            dst[j++] = encode_table_[(triple >> 18) & 0x3F];
+            dst[j++] = encode_table_[(triple >> 12) & 0x3F];
+            dst[j++] = rest == 2 ? encode_table_[(triple >> 6) & 0x3F] : static_cast<std::uint8_t>('=');
+            dst[j++] = '=';
+        }
+        return j;
+    }
+
+    std::size_t decode(const std::uint8_t *src, std::size_t len, std::uint8_t *dst) const noexcept {
+        std::size_t j = 0;
+        // A trailing partial quad is ignored, like base64_decode_into()
+        for (std::size_t i = 0; i + 4 <= len; i += 4) {
+            std::uint32_t quad = (std::uint32_t{decode_table_[src[i]]} << 18) | (std::uint32_t{decode_table_[src[i + 1]]} << 12) |
+                                 (std::uint32_t{decode_table_[src[i + 2]]} << 6) | decode_table_[src[i + 3]];
+            dst[j++] = static_cast<std::uint8_t>(quad >> 16);
+            if (src[i + 2] != '=') dst[j++] = static_cast<std::uint8_t>(quad >> 8);
+            if (src[i + 3] != '=') dst[j++] = static_cast<std::uint8_t>(quad);
+        }
+        return j;
+    }
+
+    std::array<std::uint8_t, 256> table_{};
+    std::array<std::uint8_t, 64> encode_table_{};
+    std::array<std::uint8_t, 256> decode_table_{};
+};
+
+using Encipher = Cipher<direction::encipher, encoding::base64>;
+using Decipher = Cipher<direction::decipher, encoding::base64>;
+using EncipherN64 = Cipher<direction::encipher, encoding::none>;
+using DecipherN64 = Cipher<direction::decipher, encoding::none>;
+
+} // namespace gaius
+
+#endif // GAIUS_HPP
@@ -74,6 +74,9 @@ modification follow here:
 https://raw.githubusercontent.com/Th3Tr1ckst3r/Gaius/main/LICENSE
 */
 
+#define _GNU_SOURCE          // For copy_file_range and the Linux specific flags below.
+#define _FILE_OFFSET_BITS 64 // 64-bit off_t, so files past 2 GB work on 32-bit hosts too.
+
 #include <sys/stat.h> // For stat, mkdir, and struct stat.
 #include <errno.h>    // For errno.
 #include <dirent.h>   // For working with directories.
@@ -81,37 +84,150 @@ https://raw.githubusercontent.com/Th3Tr1ckst3r/Gaius/main/LICENSE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h> // For PATH_MAX.
 #include <ctype.h>
 #include <time.h>
 #include <unistd.h> // For access() to check file existence.
+#include <sys/mman.h> // For mmap and madvise on large buffers.
+#include <fcntl.h>    // For open.
+#include <math.h>     // For log and log2 in frequency analysis.
+#include <pthread.h>  // For worker threads.
+#include <sys/ioctl.h> // For ioctl.
+#include <sys/resource.h> // For setpriority.
+#include <sys/statvfs.h> // For the free space check.
+#ifdef __linux__
+#include <linux/fs.h>  // For FICLONE.
+#include <sys/inotify.h> // For following growing files.
+#include <sys/syscall.h> // For ioprio_set.
+#include <sys/signalfd.h> // For stopping watch mode cleanly.
+#include <signal.h>
+#include <poll.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h> // For the SSE4.2 crc32 instruction.
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h> // For SSE2 text classification.
+#endif
 
 #define ALPHABET "abcdefghijklmnopqrstuvwxyz"
 #define PUNCTUATION "!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~"
 #define DEFAULT_BUFFER_SIZE 4096
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024) // Buffers at least this large are backed by huge pages.
+
+// I/O scheduling class for "-idle", as in linux/ioprio.h which glibc does not wrap.
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_CLASS_SHIFT 13
+
+// Framed output format, used when per-chunk checksums or adaptive Base64 are enabled.
+// Header: "GAIUS", format version (1 byte), flags (2 bytes, little-endian).
+// Each chunk: payload length (4 bytes LE), CRC32C of tag and payload (4 bytes LE, with GAIUS_FLAG_CRC32C),
+// chunk tag (1 byte, with GAIUS_FLAG_ADAPTIVE), payload.
+#define GAIUS_MAGIC "GAIUS"
+#define GAIUS_MAGIC_LEN 5
+#define GAIUS_FORMAT_VERSION 1
+#define GAIUS_HEADER_SIZE 8
+#define GAIUS_MAX_FRAME_HEADER_SIZE 9
+#define GAIUS_MAX_FRAMED_CHUNK ((size_t)UINT32_MAX / 4 * 3) // Largest "-chunk" whose Base64 length fits the 32-bit field.
+#define GAIUS_FLAG_CRC32C 0x0001
+#define GAIUS_FLAG_NO_BASE64 0x0002
+#define GAIUS_FLAG_RAW 0x0004
+#define GAIUS_FLAG_ADAPTIVE 0x0008
+#define GAIUS_CHUNK_BASE64 0 // Chunk tag: payload was Base64-encoded before substitution.
+#define GAIUS_CHUNK_TEXT 1   // Chunk tag: payload was printable text, substituted directly.
+
+// Size of the Base64 encoding of n bytes, excluding the null terminator.
+#define base64_encoded_size(n) (4 * (((size_t)(n) + 2) / 3))
+
+// A keyword and the output it enciphers into. Several targets fan one input out to many outputs.
+struct gaius_target {
+    const char *keyword;
+    const char *output_path;
+    char mixed_alphabet[27];
+    char punctuation_mapping[sizeof(PUNCTUATION)];
+    unsigned char table[256];
+    unsigned char encode_table[64];  // table folded into Base64 encoding, see generate_fused_tables().
+    unsigned char decode_table[256]; // table folded into Base64 decoding.
+};
+
+struct dedup_index;
+struct gaius_journal;
+struct field_selection;
+struct gaius_throttle;
+struct gaius_shard;
+struct gaius_progress;
+
+// Settings shared by every file of a run.
+struct gaius_options {
+    const char *mode;
+    int decipher;
+    int disable_base64;
+    int enable_verbosity;
+    size_t buffer_size;
+    int enable_crc;
+    int enable_raw;
+    int enable_adaptive;
+    int line_mode;                // Cipher each line as its own record, see process_lines().
+    int follow;                   // In record mode, wait for the input file to grow instead of stopping at its end.
+    struct field_selection *fields; // In record mode, the CSV columns or JSON keys to cipher, NULL to cipher whole records.
+    struct gaius_throttle *throttle; // Read, write and CPU limits, NULL when unthrottled.
+    int direct_io;                // Bypass the page cache with O_DIRECT, see process_file().
+    struct gaius_target *targets; // targets[0] holds the keyword and output path given on the command line.
+    int target_count;
+    struct dedup_index *dedup;    // Hardlink and duplicate tracking for directory mode, NULL when disabled.
+    struct gaius_journal *journal; // Completed files and checkpoints of the run, NULL when not journaling.
+    struct gaius_shard *shard;    // The files of a directory this run handles, NULL to handle all of them.
+    int jobs;                     // Files ciphered at once in directory and watch mode.
+    int space_check;              // Check the output has room before a run starts.
+    struct gaius_progress *progress; // Input bytes and files done, NULL when not reporting progress.
+};
 
 // Function declarations.
 char *base64_encode(const unsigned char *data, size_t input_length);
 char *base64_decode(const char *encoded_data, size_t *decoded_length);
+size_t base64_encode_into(const unsigned char *data, size_t input_length, char *encoded_data);
+size_t base64_decode_into(const char *encoded_data, size_t len, unsigned char *decoded_data);
+void *alloc_buffer(size_t size);
+void free_buffer(void *buffer, size_t size);
+int parse_size(const char *text, size_t *size);
 void generate_mixed_alphabet(const char *keyword, char *mixed_alphabet, char *punctuation_mapping);
+void generate_byte_table(const char *keyword, const char *mixed_alphabet, int raw, int decipher, unsigned char *table);
+void apply_table(const unsigned char *table, const unsigned char *input, size_t len, unsigned char *output);
+void generate_fused_tables(const unsigned char *table, unsigned char *encode_table, unsigned char *decode_table);
+size_t encode_substitute(const unsigned char *encode_table, const unsigned char *table, const unsigned char *data,
+                         size_t len, unsigned char *output);
+size_t substitute_decode(const unsigned char *decode_table, const unsigned char *table, const unsigned char *data,
+                         size_t len, unsigned char *output);
 void encipher(const char *input, const char *mixed_alphabet, const char *punctuation_mapping, char *output);
 void decipher(const char *input, const char *mixed_alphabet, const char *punctuation_mapping, char *output);
 int find_index(const char *str, char ch);
 void process_text(const char *input, const char *mapping, const char *reverse_mapping, char *output);
+void process_bytes(const char *input, size_t len, const char *mapping, const char *reverse_mapping, char *output);
+uint32_t crc32c(uint32_t crc, const unsigned char *data, size_t len);
 int validate_password(const char *password);
 int is_directory(const char *path);
 void create_directory(const char *path);
-void process_directory(const char *mode, const char *keyword, const char *input_dir, const char *output_dir, const char *mixed_alphabet, const char *punctuation_mapping, int disable_base64, int enable_verbosity, int buffer_size);
-void process_file(const char *mode, const char *keyword, const char *input_file, const char *output_file, const char *mixed_alphabet, const char *punctuation_mapping, int disable_base64, int enable_verbosity, int buffer_size);
+int process_directory(const struct gaius_options *options, const char *input_dir, const char *const *output_dirs);
+int process_file(const struct gaius_options *options, const char *input_file, const char *const *output_files);
+int process_lines(const struct gaius_options *options, const char *input_file, const char *const *output_files);
+struct field_selection *parse_fields(int format, const char *list);
+struct gaius_throttle *throttle_create(size_t read_rate, size_t write_rate, int cpu_percent);
+int analyze_paths(int argc, char *argv[]);
+int grep_paths(int argc, char *argv[]);
+struct gaius_journal *journal_open(const struct gaius_options *options, const char *output_path, int resume);
+void journal_close(struct gaius_journal *journal, int success);
+int parse_shard(const char *text, int *index, int *count);
+struct gaius_shard *shard_create(int index, int count, const char *input_dir, int balance);
+void shard_describe(const struct gaius_shard *shard, char *buffer, size_t size);
+int watch_tree(const struct gaius_options *options, const char *input_dir, const char *const *output_dirs, int jobs);
 
 // Function to encode data in Base64.
 const char *b64_table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-// Function to encode raw data in Base64.
-char *base64_encode(const unsigned char *data, size_t input_length) {
-    size_t output_length = 4 * ((input_length + 2) / 3);  // Output length must be 4 times the size of input
-    char *encoded_data = malloc(output_length + 1);  // +1 for null terminator
-
-    if (encoded_data == NULL) return NULL;  // Error checking for malloc failure
+// Function to encode raw data in Base64 into a caller-provided buffer of base64_encoded_size() + 1 bytes.
+size_t base64_encode_into(const unsigned char *data, size_t input_length, char *encoded_data) {
+    size_t output_length = base64_encoded_size(input_length);
 
     for (size_t i = 0, j = 0; i < input_length;) {
         unsigned long octet_a = i < input_length ? (unsigned char)data[i++] : 0;
@@ -127,44 +243,70 @@ char *base64_encode(const unsigned char *data, size_t input_length) {
     }
 
     // Add padding if necessary
-    for (int i = 0; i < 3 - (input_length % 3); i++) {
-        encoded_data[output_length - 1 - i] = '=';
+    if (input_length % 3) {
+        for (size_t i = 0; i < 3 - (input_length % 3); i++) {
+            encoded_data[output_length - 1 - i] = '=';
+        }
     }
 
     encoded_data[output_length] = '\0';  // Null-terminate the string
-    return encoded_data;
+    return output_length;
 }
 
-// Function to decode Base64 data into raw data.
-char *base64_decode(const char *encoded_data, size_t *decoded_length) {
-    size_t len = strlen(encoded_data);
-    *decoded_length = (len / 4) * 3;  // The decoded length is 3/4 of the encoded length
+// Function to encode raw data in Base64.
+char *base64_encode(const unsigned char *data, size_t input_length) {
+    char *encoded_data = malloc(base64_encoded_size(input_length) + 1);  // +1 for null terminator
 
-    // Handle padding '=' characters
-    if (encoded_data[len - 1] == '=') (*decoded_length)--;
-    if (encoded_data[len - 2] == '=') (*decoded_length)--;
+    if (encoded_data == NULL) return NULL;  // Error checking for malloc failure
 
-    char *decoded_data = malloc(*decoded_length);  // Allocate memory for the decoded data
-    if (decoded_data == NULL) {
-        perror("Failed to allocate memory for decoded data");
-        return NULL;
+    base64_encode_into(data, input_length, encoded_data);
+    return encoded_data;
+}
+
+static unsigned char reverse_table[256];
+static pthread_once_t reverse_table_once = PTHREAD_ONCE_INIT;
+
+// Function to build the Base64 reverse lookup table, run once even with several threads decoding.
+static void build_reverse_table(void) {
+    for (size_t i = 0; i < 64; i++) {
+        reverse_table[(unsigned char)b64_table[i]] = (unsigned char)i;
     }
+}
 
-    int i = 0, j = 0;
+// Function to decode Base64 data of a known length into a caller-provided buffer.
+// Decoding in place is allowed, the output never overtakes the input. Returns the decoded length.
+size_t base64_decode_into(const char *encoded_data, size_t len, unsigned char *decoded_data) {
+    size_t i = 0, j = 0;
     unsigned char a, b, c, d;
 
-    // Loop through the encoded data in 4-character blocks
-    while (i < len) {
-        a = strchr(b64_table, encoded_data[i++]) - b64_table;
-        b = strchr(b64_table, encoded_data[i++]) - b64_table;
-        c = strchr(b64_table, encoded_data[i++]) - b64_table;
-        d = strchr(b64_table, encoded_data[i++]) - b64_table;
+    pthread_once(&reverse_table_once, build_reverse_table);
+
+    // Loop through the encoded data in 4-character blocks, a trailing partial block is ignored
+    while (i + 4 <= len) {
+        a = reverse_table[(unsigned char)encoded_data[i++]];
+        b = reverse_table[(unsigned char)encoded_data[i++]];
+        c = reverse_table[(unsigned char)encoded_data[i++]];
+        d = reverse_table[(unsigned char)encoded_data[i++]];
 
         decoded_data[j++] = (a << 2) | (b >> 4);
         if (encoded_data[i - 2] != '=') decoded_data[j++] = (b << 4) | (c >> 2);
         if (encoded_data[i - 1] != '=') decoded_data[j++] = (c << 6) | d;
     }
 
+    return j;
+}
+
+// Function to decode Base64 data into raw data.
+char *base64_decode(const char *encoded_data, size_t *decoded_length) {
+    size_t len = strlen(encoded_data);
+
+    char *decoded_data = malloc(len / 4 * 3 + 1);  // Allocate memory for the decoded data
+    if (decoded_data == NULL) {
+        perror("Failed to allocate memory for decoded data");
+        return NULL;
+    }
+
+    *decoded_length = base64_decode_into(encoded_data, len, (unsigned char *)decoded_data);
     return decoded_data;
 }
 
@@ -219,6 +361,133 @@ void generate_mixed_alphabet(const char *keyword, char *mixed_alphabet, char *pu
     }
 }
 
+// Function to build the 256-entry byte substitution table used by process_file().
+// Without raw mode only letters are substituted, exactly as process_text() does. Raw mode extends
+// the keyword ordering of the mixed alphabet to every other byte value, so binary data is ciphered
+// without Base64. NUL stays fixed so zero-filled regions of binaries remain zero, as with -n64.
+void generate_byte_table(const char *keyword, const char *mixed_alphabet, int raw, int decipher, unsigned char *table) {
+    unsigned char forward[256];
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        forward[i] = (unsigned char)i;
+    }
+
+    // Letters map from the mixed alphabet back to the plain one, keeping their case
+    for (i = 0; i < 26; i++) {
+        forward[(unsigned char)mixed_alphabet[i]] = ALPHABET[i];
+        forward[toupper((unsigned char)mixed_alphabet[i])] = toupper(ALPHABET[i]);
+    }
+
+    if (raw) {
+        // Order every non-letter byte the way generate_mixed_alphabet() orders letters:
+        // unique keyword bytes first, then the remaining values in ascending order
+        unsigned char mixed[256], plain[256];
+        int used[256] = {0}, j = 0, k = 0;
+
+        for (const unsigned char *p = (const unsigned char *)keyword; *p; p++) {
+            if (!isalpha(*p) && !used[*p]) {
+                mixed[j++] = *p;
+                used[*p] = 1;
+            }
+        }
+        for (i = 1; i < 256; i++) {
+            if (!isalpha(i)) {
+                plain[k++] = (unsigned char)i;
+                if (!used[i]) {
+                    mixed[j++] = (unsigned char)i;
+                }
+            }
+        }
+        for (i = 0; i < k; i++) {
+            forward[mixed[i]] = plain[i];
+        }
+    }
+
+    if (decipher) {
+        for (i = 0; i < 256; i++) {
+            table[forward[i]] = (unsigned char)i;
+        }
+    } else {
+        memcpy(table, forward, 256);
+    }
+}
+
+// Function to substitute a buffer through a byte table, input and output may be the same buffer.
+void apply_table(const unsigned char *table, const unsigned char *input, size_t len, unsigned char *output) {
+    size_t i = 0;
+
+    // Unrolled so the independent lookups can overlap
+    for (; i + 4 <= len; i += 4) {
+        unsigned char a = table[input[i]], b = table[input[i + 1]], c = table[input[i + 2]], d = table[input[i + 3]];
+        output[i] = a;
+        output[i + 1] = b;
+        output[i + 2] = c;
+        output[i + 3] = d;
+    }
+    for (; i < len; i++) {
+        output[i] = table[input[i]];
+    }
+}
+
+// Function to fold a substitution table into Base64, giving a 64-entry table that encodes and substitutes
+// in one lookup, and a 256-entry table that substitutes and decodes in one lookup.
+void generate_fused_tables(const unsigned char *table, unsigned char *encode_table, unsigned char *decode_table) {
+    unsigned char reverse_table[256] = {0};
+
+    for (int i = 0; i < 64; i++) {
+        encode_table[i] = table[(unsigned char)b64_table[i]];
+        reverse_table[(unsigned char)b64_table[i]] = (unsigned char)i;
+    }
+    for (int i = 0; i < 256; i++) {
+        decode_table[i] = reverse_table[table[i]];
+    }
+}
+
+// Function to Base64-encode and substitute in one pass, the same as apply_table() over base64_encode_into().
+size_t encode_substitute(const unsigned char *encode_table, const unsigned char *table, const unsigned char *data,
+                         size_t len, unsigned char *output) {
+    size_t i = 0, j = 0;
+
+    for (; i + 3 <= len; i += 3) {
+        uint32_t triple = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | data[i + 2];
+        output[j] = encode_table[(triple >> 18) & 0x3F];
+        output[j + 1] = encode_table[(triple >> 12) & 0x3F];
+        output[j + 2] = encode_table[(triple >> 6) & 0x3F];
+        output[j + 3] = encode_table[triple & 0x3F];
+        j += 4;
+    }
+    if (i < len) {
+        uint32_t triple = (uint32_t)data[i] << 16;
+        if (i + 1 < len) {
+            triple |= (uint32_t)data[i + 1] << 8;
+        }
+        output[j] = encode_table[(triple >> 18) & 0x3F];
+        output[j + 1] = encode_table[(triple >> 12) & 0x3F];
+        output[j + 2] = i + 1 < len ? encode_table[(triple >> 6) & 0x3F] : table['='];
+        output[j + 3] = table['='];
+        j += 4;
+    }
+    return j;
+}
+
+// Function to substitute and Base64-decode in one pass, the same as base64_decode_into() over apply_table().
+// Decoding in place is allowed.
+size_t substitute_decode(const unsigned char *decode_table, const unsigned char *table, const unsigned char *data,
+                         size_t len, unsigned char *output) {
+    size_t j = 0;
+
+    for (size_t i = 0; i + 4 <= len; i += 4) {
+        uint32_t quad = ((uint32_t)decode_table[data[i]] << 18) | ((uint32_t)decode_table[data[i + 1]] << 12) |
+                        ((uint32_t)decode_table[data[i + 2]] << 6) | decode_table[data[i + 3]];
+        int third = table[data[i + 2]] != '=', fourth = table[data[i + 3]] != '=';
+        output[j++] = (unsigned char)(quad >> 16);
+        if (third) output[j++] = (unsigned char)(quad >> 8);
+        if (fourth) output[j++] = (unsigned char)quad;
+    }
+    return j;
+}
+
 // Function to encipher text using mixed alphabet and punctuation mapping.
 void encipher(const char *input, const char *mixed_alphabet, const char *punctuation_mapping, char *output) {
     size_t i, len = strlen(input);
@@ -263,9 +532,14 @@ int find_index(const char *str, char ch) {
 
 // Function to process text for enciphering, or deciphering.
 void process_text(const char *input, const char *mapping, const char *reverse_mapping, char *output) {
-    size_t i, len = strlen(input);
+    process_bytes(input, strlen(input), mapping, reverse_mapping, output);
+}
+
+// Function to process a buffer of known length, which may contain NUL bytes.
+void process_bytes(const char *input, size_t len, const char *mapping, const char *reverse_mapping, char *output) {
+    size_t i;
     for (i = 0; i < len; i++) {
-        char ch = input[i];
+        unsigned char ch = (unsigned char)input[i];
 
         // Handle alphabetic characters (both uppercase and lowercase)
         if (isalpha(ch)) {
@@ -275,7 +549,7 @@ void process_text(const char *input, const char *mapping, const char *reverse_ma
             }
         }
         // Handle punctuation characters
-        else if (strchr(PUNCTUATION, ch)) {
+        else if (ch != '\0' && strchr(PUNCTUATION, ch)) {
             int index = find_index(mapping, ch);
             if (index != -1) {
                 output[i] = reverse_mapping[index];
@@ -291,6 +565,87 @@ void process_text(const char *input, const char *mapping, const char *reverse_ma
     output[i] = '\0';  // Null-terminate the output string
 }
 
+// Table for the software CRC32C fallback (Castagnoli polynomial, reflected).
+static uint32_t crc32c_table[256];
+
+// Function to build the CRC32C lookup table.
+static void crc32c_init_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0x82F63B78 & -(crc & 1));
+        }
+        crc32c_table[i] = crc;
+    }
+}
+
+// Function to compute CRC32C with the lookup table.
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *data, size_t len) {
+    while (len--) {
+        crc = crc32c_table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Function to compute CRC32C with the SSE4.2 crc32 instruction.
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char *data, size_t len) {
+#if defined(__x86_64__)
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)crc64;
+#endif
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+    return crc;
+}
+#endif
+
+static uint32_t (*crc32c_impl)(uint32_t, const unsigned char *, size_t) = NULL;
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+// Function to pick the CRC32C implementation, run once even with several threads checksumming.
+static void crc32c_select(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32c_impl = crc32c_hw;
+    }
+#endif
+    if (!crc32c_impl) {
+        crc32c_init_table();
+        crc32c_impl = crc32c_sw;
+    }
+}
+
+// Function to compute CRC32C, picking the hardware or table implementation on first use.
+// Takes and returns a finalized checksum, so it can be called incrementally starting from 0.
+uint32_t crc32c(uint32_t crc, const unsigned char *data, size_t len) {
+    pthread_once(&crc32c_once, crc32c_select);
+    return ~crc32c_impl(~crc, data, len);
+}
+
+// Function to store a 32-bit value in little-endian byte order.
+static void write_le32(unsigned char *p, uint32_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+// Function to load a 32-bit value stored in little-endian byte order.
+static uint32_t read_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
 // Function to validate the keyword/password.
 int validate_password(const char *password) {
     int has_special = 0, has_digit = 0, length = strlen(password);
@@ -328,238 +683,5055 @@ void create_directory(const char *path) {
     }
 }
 
-// Function to process a single file.
-void process_file(const char *mode, const char *keyword, const char *input_file, const char *output_file, 
-                  const char *mixed_alphabet, const char *punctuation_mapping, int disable_base64, int enable_verbosity, int buffer_size) {
-    if (enable_verbosity) {
-        printf("Processing file: %s\n", input_file);
-        printf("Output file: %s\n", output_file);
-        printf("Mode: %s\n", mode);
-        printf("Base64 Encoding Disabled: %s\n", disable_base64 ? "Yes" : "No");
-        printf("Buffer Size: %d bytes\n", buffer_size);
+// Function to allocate a processing buffer, large ones are mapped with huge pages to cut TLB misses.
+void *alloc_buffer(size_t size) {
+    if (size < HUGE_PAGE_SIZE) {
+        return malloc(size);
     }
 
-    // Open input and output files
-    FILE *input_fp = fopen(input_file, "rb");
-    if (!input_fp) {
-        perror("Error opening input file");
-        return;
+    size_t mapped_size = (size + HUGE_PAGE_SIZE - 1) & ~((size_t)HUGE_PAGE_SIZE - 1);
+    void *buffer = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    // Explicit huge pages only succeed if the administrator reserved some, so fall through quietly
+    buffer = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (buffer == MAP_FAILED) {
+        buffer = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffer == MAP_FAILED) {
+            return NULL;
+        }
+#ifdef MADV_HUGEPAGE
+        madvise(buffer, mapped_size, MADV_HUGEPAGE); // Transparent huge pages, best effort
+#endif
     }
+    return buffer;
+}
 
-    FILE *output_fp = fopen(output_file, "wb");
-    if (!output_fp) {
-        perror("Error opening output file");
-        fclose(input_fp);
+// Function to release a buffer from alloc_buffer(), size must match the allocation.
+void free_buffer(void *buffer, size_t size) {
+    if (!buffer) {
         return;
     }
-
-    unsigned char *buffer = malloc(buffer_size);
-    unsigned char *processed_buffer = malloc(buffer_size * 2); // Allocate for worst-case size
-    if (!buffer || !processed_buffer) {
-        perror("Memory allocation failed for buffers");
+    if (size < HUGE_PAGE_SIZE) {
         free(buffer);
-        free(processed_buffer);
-        fclose(input_fp);
-        fclose(output_fp);
-        return;
+    } else {
+        munmap(buffer, (size + HUGE_PAGE_SIZE - 1) & ~((size_t)HUGE_PAGE_SIZE - 1));
     }
+}
 
-    size_t bytes_read, bytes_processed;
-
-    while ((bytes_read = fread(buffer, 1, buffer_size, input_fp)) > 0) {
-        if (strcmp(mode, "encipher") == 0) {
-            if (!disable_base64) {
-                // Encode input to Base64 before ciphering
-                char *encoded_data = base64_encode(buffer, bytes_read);
-                if (!encoded_data) {
-                    fprintf(stderr, "Failed to encode data for file: %s\n", input_file);
-                    break;
-                }
-                process_text(encoded_data, mixed_alphabet, ALPHABET, (char *)processed_buffer);
-                fwrite(processed_buffer, 1, strlen((char *)processed_buffer), output_fp);
-                free(encoded_data);
-            } else {
-                // Cipher directly without Base64
-                process_text((char *)buffer, mixed_alphabet, ALPHABET, (char *)processed_buffer);
-                fwrite(processed_buffer, 1, bytes_read, output_fp);
-            }
-        } else if (strcmp(mode, "decipher") == 0) {
-            if (!disable_base64) {
-                // Decipher the text
-                process_text((char *)buffer, ALPHABET, mixed_alphabet, (char *)processed_buffer);
-
-                // Decode Base64 after ciphering
-                size_t decoded_length;
-                char *decoded_data = base64_decode((char *)processed_buffer, &decoded_length);
-                if (!decoded_data) {
-                    fprintf(stderr, "Failed to decode data for file: %s\n", input_file);
-                    break;
-                }
-                fwrite(decoded_data, 1, decoded_length, output_fp);
-                free(decoded_data);
-            } else {
-                // Decipher directly without Base64
-                process_text((char *)buffer, ALPHABET, mixed_alphabet, (char *)processed_buffer);
-                fwrite(processed_buffer, 1, bytes_read, output_fp);
-            }
-        } else {
-            fprintf(stderr, "Error: Invalid mode for file: %s\n", input_file);
-            break;
-        }
+// Function to parse a byte count with an optional K, M or G suffix (powers of 1024).
+int parse_size(const char *text, size_t *size) {
+    char *end;
 
-        if (enable_verbosity) {
-            printf("Processed %zu bytes from input file.\n", bytes_read);
-        }
+    if (!isdigit((unsigned char)text[0])) {
+        return -1;
+    }
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (errno != 0) {
+        return -1;
     }
 
-    if (enable_verbosity) {
-        printf("File processing complete. Output written to: %s\n", output_file);
+    int shift = 0;
+    switch (toupper((unsigned char)*end)) {
+        case 'K': shift = 10; end++; break;
+        case 'M': shift = 20; end++; break;
+        case 'G': shift = 30; end++; break;
+        case '\0': break;
+        default: return -1;
     }
+    if (*end != '\0' || value > (SIZE_MAX >> shift)) {
+        return -1;
+    }
+    *size = (size_t)(value << shift);
+    return 0;
+}
 
-    // Cleanup
-    free(buffer);
-    free(processed_buffer);
-    fclose(input_fp);
-    fclose(output_fp);
+// Function to write the framed format header.
+static int write_frame_header(FILE *output_fp, uint16_t flags) {
+    unsigned char header[GAIUS_HEADER_SIZE];
+    memcpy(header, GAIUS_MAGIC, GAIUS_MAGIC_LEN);
+    header[5] = GAIUS_FORMAT_VERSION;
+    header[6] = flags & 0xFF;
+    header[7] = (flags >> 8) & 0xFF;
+    return fwrite(header, 1, sizeof(header), output_fp) == sizeof(header) ? 0 : -1;
 }
 
-// Recursive function to process a directory.
-void process_directory(const char *mode, const char *keyword, const char *input_dir, const char *output_dir, 
-                       const char *mixed_alphabet, const char *punctuation_mapping, int disable_base64, int enable_verbosity, int buffer_size) {
-    if (enable_verbosity) {
-        printf("Processing directory: %s\n", input_dir);
-        printf("Output directory: %s\n", output_dir);
-    }
+// Function to get the size of each chunk's header for the given format flags.
+static size_t frame_header_size(uint16_t flags) {
+    return 4 + ((flags & GAIUS_FLAG_CRC32C) ? 4 : 0) + ((flags & GAIUS_FLAG_ADAPTIVE) ? 1 : 0);
+}
 
-    // Open the input directory
-    DIR *dir = opendir(input_dir);
-    if (!dir) {
-        perror("Failed to open input directory");
-        exit(1);
+// Function to write one chunk with its length, and its CRC32C and tag if the flags call for them.
+static int write_frame(FILE *output_fp, uint16_t flags, unsigned char tag, const unsigned char *payload, size_t len) {
+    unsigned char frame_header[GAIUS_MAX_FRAME_HEADER_SIZE];
+    size_t header_size = frame_header_size(flags);
+
+    write_le32(frame_header, (uint32_t)len);
+    if (flags & GAIUS_FLAG_ADAPTIVE) {
+        frame_header[header_size - 1] = tag;
+    }
+    if (flags & GAIUS_FLAG_CRC32C) {
+        uint32_t crc = (flags & GAIUS_FLAG_ADAPTIVE) ? crc32c(0, &tag, 1) : 0;
+        write_le32(frame_header + 4, crc32c(crc, payload, len));
+    }
+    if (fwrite(frame_header, 1, header_size, output_fp) != header_size) {
+        return -1;
     }
+    return fwrite(payload, 1, len, output_fp) == len ? 0 : -1;
+}
 
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip "." and ".." entries
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
+// Function to check whether a chunk is printable text that can skip Base64.
+// Accepts printable ASCII plus tab, newline and carriage return.
+static int is_printable_text(const unsigned char *data, size_t len) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(0x20), del = _mm_set1_epi8(0x7F);
+    const __m128i tab = _mm_set1_epi8('\t'), newline = _mm_set1_epi8('\n'), carriage = _mm_set1_epi8('\r');
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        // Signed compare, so bytes of 0x80 and up count as below space too
+        __m128i bad = _mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, del));
+        __m128i allowed = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_cmpeq_epi8(v, newline)), _mm_cmpeq_epi8(v, carriage));
+        if (_mm_movemask_epi8(_mm_andnot_si128(allowed, bad))) {
+            return 0;
         }
+    }
+#endif
+    for (; i < len; i++) {
+        unsigned char ch = data[i];
+        if ((ch < 0x20 || ch >= 0x7F) && ch != '\t' && ch != '\n' && ch != '\r') {
+            return 0;
+        }
+    }
+    return 1;
+}
 
-        char input_path[1024], output_path[1024];
-        snprintf(input_path, sizeof(input_path), "%s/%s", input_dir, entry->d_name);
-        snprintf(output_path, sizeof(output_path), "%s/%s", output_dir, entry->d_name);
+// Function to check for the framed format header, leaving the stream at the first chunk if found.
+// Returns 1 if the file is framed, 0 if it is a plain stream, and -1 on an unsupported version.
+static int read_frame_header(FILE *input_fp, uint16_t *flags) {
+    unsigned char header[GAIUS_HEADER_SIZE];
+    size_t got = fread(header, 1, sizeof(header), input_fp);
 
-        if (is_directory(input_path)) {
-            // Process subdirectory
-            if (enable_verbosity) {
-                printf("Found directory: %s\n", input_path);
-                printf("Creating output directory: %s\n", output_path);
-            }
-            create_directory(output_path);
-            process_directory(mode, keyword, input_path, output_path, mixed_alphabet, punctuation_mapping, disable_base64, enable_verbosity, buffer_size);
-        } else {
-            // Process file
-            if (enable_verbosity) {
-                printf("Found file: %s\n", input_path);
-            }
-            process_file(mode, keyword, input_path, output_path, mixed_alphabet, punctuation_mapping, disable_base64, enable_verbosity, buffer_size);
+    if (got == sizeof(header) && memcmp(header, GAIUS_MAGIC, GAIUS_MAGIC_LEN) == 0) {
+        if (header[5] != GAIUS_FORMAT_VERSION) {
+            return -1;
         }
+        *flags = header[6] | (header[7] << 8);
+        return 1;
     }
+    rewind(input_fp);
+    return 0;
+}
 
-    if (enable_verbosity) {
-        printf("Finished processing directory: %s\n", input_dir);
-    }
+// Function to get a monotonic timestamp in nanoseconds.
+static long long monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
 
-    closedir(dir);
+// Throttling for background runs. Read and write rates are token buckets in bytes, and the CPU limit is a
+// token bucket in nanoseconds of CPU time, so a run never uses more than its share over any stretch of time.
+
+#define THROTTLE_BURST_NS 250000000LL // Idle credit a bucket may save up, as time at its full rate.
+
+// Tokens refill at rate per nanosecond up to burst, a consumer that overdraws sleeps off the debt.
+struct token_bucket {
+    double rate;  // Tokens per nanosecond, 0 when unlimited.
+    double burst;
+    double tokens;
+    long long last_ns;
+};
+
+struct gaius_throttle {
+    struct token_bucket read, write, cpu;
+    long long cpu_ns; // Process CPU time when it was last charged to the CPU bucket.
+    pthread_mutex_t lock; // Watch mode workers share the limits.
+};
+
+// Function to get the CPU time used by the process in nanoseconds.
+static long long process_cpu_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
 }
 
-// Main function to process arguments.
-int main(int argc, char *argv[]) {
-    int disable_base64 = 0;
-    int enable_verbosity = 0;
-    int buffer_size = DEFAULT_BUFFER_SIZE;
+// Function to set a bucket to rate tokens per second, starting full.
+static void bucket_init(struct token_bucket *bucket, double per_second) {
+    bucket->rate = per_second / 1e9;
+    bucket->burst = bucket->rate * THROTTLE_BURST_NS;
+    bucket->tokens = bucket->burst;
+    bucket->last_ns = monotonic_ns();
+}
 
-    // Parse optional flags
-    for (int i = 5; i < argc; i++) {
-        if (strcmp(argv[i], "-n64") == 0) {
-            disable_base64 = 1;
-        } else if (strcmp(argv[i], "-v") == 0) {
-            enable_verbosity = 1;
-        } else if (strcmp(argv[i], "-chunk") == 0) {
-            // Ensure a value follows the "-chunk" flag
-            if (i + 1 < argc) {
-                buffer_size = atoi(argv[++i]); // Convert the next argument to an integer
-                if (buffer_size <= 0) {
-                    fprintf(stderr, "Error: Invalid buffer size '%s'. Must be a positive integer.\n", argv[i]);
-                    return 1;
-                }
-                // Ensure the buffer_size is at least 1024 bytes
-                if (buffer_size < 1024) {
-                    fprintf(stderr, "Error: Buffer size cannot be less than 1024 bytes. Setting to 1024 bytes.\n");
-                    buffer_size = 1024;
-                }
-            } else {
-                fprintf(stderr, "Error: Missing value for '-chunk' flag.\n");
-                return 1;
-            }
-        } else {
-            fprintf(stderr, "Error: Unknown flag '%s'.\n", argv[i]);
-            return 1;
+// Function to take tokens from a bucket, returning how long to sleep to repay the debt if there were not enough.
+static long long bucket_consume(struct token_bucket *bucket, double tokens) {
+    if (bucket->rate == 0) {
+        return 0;
+    }
+    long long now = monotonic_ns();
+    bucket->tokens += (now - bucket->last_ns) * bucket->rate;
+    if (bucket->tokens > bucket->burst) {
+        bucket->tokens = bucket->burst;
+    }
+    bucket->tokens -= tokens;
+    bucket->last_ns = now;
+    return bucket->tokens < 0 ? (long long)(-bucket->tokens / bucket->rate) : 0;
+}
+
+// Function to set up the limits of a run, a zero limit is unlimited. cpu_percent is a share of one core.
+struct gaius_throttle *throttle_create(size_t read_rate, size_t write_rate, int cpu_percent) {
+    struct gaius_throttle *throttle = calloc(1, sizeof(*throttle));
+    if (!throttle) {
+        perror("Memory allocation failed for throttle");
+        return NULL;
+    }
+    if (read_rate) {
+        bucket_init(&throttle->read, (double)read_rate);
+    }
+    if (write_rate) {
+        bucket_init(&throttle->write, (double)write_rate);
+    }
+    if (cpu_percent) {
+        bucket_init(&throttle->cpu, cpu_percent * 1e9 / 100);
+        throttle->cpu_ns = process_cpu_ns();
+    }
+    pthread_mutex_init(&throttle->lock, NULL);
+    return throttle;
+}
+
+// Function to charge a chunk's reads, writes and the CPU time spent on it since the last chunk.
+static void throttle_chunk(struct gaius_throttle *throttle, size_t bytes_read, size_t bytes_written) {
+    if (!throttle) {
+        return;
+    }
+    // Every bucket refills during the same pause, so the longest debt is the one to sleep off
+    pthread_mutex_lock(&throttle->lock);
+    long long pause_ns = bucket_consume(&throttle->read, (double)bytes_read);
+    long long debt_ns = bucket_consume(&throttle->write, (double)bytes_written);
+    if (debt_ns > pause_ns) {
+        pause_ns = debt_ns;
+    }
+    if (throttle->cpu.rate != 0) {
+        long long cpu_ns = process_cpu_ns();
+        debt_ns = bucket_consume(&throttle->cpu, (double)(cpu_ns - throttle->cpu_ns));
+        if (debt_ns > pause_ns) {
+            pause_ns = debt_ns;
         }
+        throttle->cpu_ns = cpu_ns;
     }
+    pthread_mutex_unlock(&throttle->lock);
 
-    // Validate argument count
-    if (argc < 5) {
-        fprintf(stderr,
-                "Gaius V1.1 - A cryptography tool which implements a new complex mixed substitution cipher dubbed 'Gaius Cipher' into binary/plaintext data structures.\n\n\n"
-                "Usage: gaius <encipher|decipher> <password|keyword> <input_file> <output_file> [-n64, -v, -chunk <size>]\n\n"
-                "Optional Usage: \n\n"
-                "-n64    Disables utilization of base64 in the cipher process.\n"
-                "-v      Enables verbose output for debugging.\n"
-                "-chunk  Specifies the buffer size for processing files (default: 4096 bytes).\n\n"
-                "For more information, including documentation, please visit https://www.github.com/Th3Tr1ckst3r/Gaius\n\n");
-        return 1;
+    if (pause_ns > 0) {
+        struct timespec pause = {pause_ns / 1000000000LL, pause_ns % 1000000000LL};
+        while (nanosleep(&pause, &pause) != 0 && errno == EINTR) {
+        }
     }
+}
 
-    const char *mode = argv[1];
-    const char *keyword = argv[2];
-    const char *input_path = argv[3];
-    const char *output_path = argv[4];
+// Progress of a run, measured against the totals found before it starts. Workers add the input bytes they
+// get through, and a reporter thread prints how far the run is, its rate and the time left once a second.
 
-    if (!validate_password(keyword)) {
-        fprintf(stderr, "Error: Password must be at least 8 characters long, contain at least 1 special character, and 1 integer.\n");
-        return 1;
+#define PROGRESS_INTERVAL_NS 1000000000LL
+
+struct gaius_progress {
+    uint64_t total_bytes;
+    uint64_t total_files;
+    uint64_t done_bytes; // Updated atomically, workers add to it without the lock.
+    uint64_t done_files; // Updated atomically.
+    long long start_ns;
+    int stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t stop;
+    pthread_t thread;
+};
+
+// Function to count input bytes done, NULL progress counts nothing.
+static void progress_add(struct gaius_progress *progress, off_t bytes) {
+    if (progress && bytes > 0) {
+        __atomic_fetch_add(&progress->done_bytes, (uint64_t)bytes, __ATOMIC_RELAXED);
     }
+}
 
-    if (!is_directory(input_path) && access(input_path, F_OK) == -1) {
-        fprintf(stderr, "Error: Input path does not exist.\n");
-        return 1;
+// Function to write a byte count with a binary unit, like the K/M/G suffixes of parse_size().
+static void format_size(uint64_t bytes, char *buffer, size_t size) {
+    static const char *units[] = {"bytes", "KB", "MB", "GB", "TB"};
+    double value = (double)bytes;
+    int unit = 0;
+    while (value >= 1024 && unit < 4) {
+        value /= 1024;
+        unit++;
     }
+    snprintf(buffer, size, unit ? "%.2f %s" : "%.0f %s", value, units[unit]);
+}
 
-    if (is_directory(output_path)) {
-        create_directory(output_path);
+// Function to print one progress report to stderr, on a single updating line when it is a terminal.
+static void progress_report(struct gaius_progress *progress, int last) {
+    uint64_t done = __atomic_load_n(&progress->done_bytes, __ATOMIC_RELAXED);
+    uint64_t files = __atomic_load_n(&progress->done_files, __ATOMIC_RELAXED);
+    double elapsed = (monotonic_ns() - progress->start_ns) / 1e9;
+    double rate = elapsed > 0 ? done / elapsed : 0;
+    char done_text[32], total_text[32], rate_text[32], time_text[48] = "ETA unknown";
+
+    format_size(done, done_text, sizeof(done_text));
+    format_size(progress->total_bytes, total_text, sizeof(total_text));
+    format_size((uint64_t)rate, rate_text, sizeof(rate_text));
+    if (last) {
+        snprintf(time_text, sizeof(time_text), "done in %.1fs", elapsed);
+    } else if (rate > 0) {
+        long long left = (long long)((progress->total_bytes > done ? progress->total_bytes - done : 0) / rate + 0.5);
+        snprintf(time_text, sizeof(time_text), "ETA %lldh%02lldm%02llds", left / 3600, left / 60 % 60, left % 60);
     }
+    int terminal = isatty(STDERR_FILENO);
+    fprintf(stderr, "%sProgress: %s of %s (%.1f%%), %llu of %llu files, %s/s, %s%s", terminal ? "\r" : "",
+            done_text, total_text, progress->total_bytes ? 100.0 * done / progress->total_bytes : 100.0,
+            (unsigned long long)files, (unsigned long long)progress->total_files, rate_text, time_text,
+            terminal && !last ? "\033[K" : terminal ? "\033[K\n" : "\n");
+}
 
-    char mixed_alphabet[27];
-    char punctuation_mapping[strlen(PUNCTUATION) + 1];
-    generate_mixed_alphabet(keyword, mixed_alphabet, punctuation_mapping);
+// Reporter thread: prints progress every PROGRESS_INTERVAL_NS until stopped.
+static void *progress_reporter(void *arg) {
+    struct gaius_progress *progress = arg;
 
-    if (enable_verbosity) {
-        printf("Mode: %s\n", mode);
-        printf("Keyword: %s\n", keyword);
-        printf("Input Path: %s\n", input_path);
-        printf("Output Path: %s\n", output_path);
-        printf("Disable Base64: %s\n", disable_base64 ? "Yes" : "No");
-        printf("Verbosity Enabled: Yes\n");
-        printf("Buffer Size: %d bytes\n", buffer_size);
+    pthread_mutex_lock(&progress->lock);
+    while (!progress->stopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += PROGRESS_INTERVAL_NS / 1000000000LL;
+        if (pthread_cond_timedwait(&progress->stop, &progress->lock, &deadline) != 0 && !progress->stopping) {
+            progress_report(progress, 0);
+        }
     }
+    pthread_mutex_unlock(&progress->lock);
+    return NULL;
+}
 
-    if (is_directory(input_path)) {
-        create_directory(output_path);
-        process_directory(mode, keyword, input_path, output_path, mixed_alphabet, punctuation_mapping, disable_base64, enable_verbosity, buffer_size);
-    } else {
-        process_file(mode, keyword, input_path, output_path, mixed_alphabet, punctuation_mapping, disable_base64, enable_verbosity, buffer_size);
+// Function to start reporting progress against the given totals.
+static void progress_start(struct gaius_progress *progress, uint64_t total_bytes, uint64_t total_files) {
+    progress->total_bytes = total_bytes;
+    progress->total_files = total_files;
+    progress->start_ns = monotonic_ns();
+    pthread_mutex_init(&progress->lock, NULL);
+    pthread_cond_init(&progress->stop, NULL);
+    if (pthread_create(&progress->thread, NULL, progress_reporter, progress) != 0) {
+        fprintf(stderr, "Warning: Could not start progress reporting.\n");
+        progress->stopping = 1;
     }
+}
 
-    return 0;
+// Function to stop reporting progress, printing the final totals.
+static void progress_finish(struct gaius_progress *progress) {
+    if (!progress->stopping) {
+        pthread_mutex_lock(&progress->lock);
+        progress->stopping = 1;
+        pthread_cond_signal(&progress->stop);
+        pthread_mutex_unlock(&progress->lock);
+        pthread_join(progress->thread, NULL);
+        progress_report(progress, 1);
+    }
+    pthread_cond_destroy(&progress->stop);
+    pthread_mutex_destroy(&progress->lock);
+}
+
+// Function to decipher a framed file, verifying each chunk's CRC32C before it is used.
+static int decipher_framed_file(FILE *input_fp, FILE *output_fp, const char *input_file, const char *keyword,
+                                const char *mixed_alphabet, uint16_t flags, int enable_verbosity, struct gaius_throttle *throttle) {
+    unsigned char frame_header[GAIUS_MAX_FRAME_HEADER_SIZE];
+    size_t header_size = frame_header_size(flags);
+    unsigned char table[256], encode_table[64], decode_table[256];
+    unsigned char *buffer = NULL, *processed_buffer = NULL;
+    size_t capacity = 0, chunk_index = 0, got;
+    off_t frame_offset = GAIUS_HEADER_SIZE;
+    struct stat input_stat;
+    int bounded = fstat(fileno(input_fp), &input_stat) == 0 && S_ISREG(input_stat.st_mode);
+    int status = 0;
+
+    generate_byte_table(keyword, mixed_alphabet, (flags & GAIUS_FLAG_RAW) != 0, 1, table);
+    generate_fused_tables(table, encode_table, decode_table);
+
+    while ((got = fread(frame_header, 1, header_size, input_fp)) > 0) {
+        if (got != header_size) {
+            fprintf(stderr, "Error: Truncated chunk %zu at offset %lld in file: %s\n", chunk_index, (long long)frame_offset, input_file);
+            status = -1;
+            break;
+        }
+        size_t len = read_le32(frame_header);
+        unsigned char tag = (flags & GAIUS_FLAG_ADAPTIVE) ? frame_header[header_size - 1] : GAIUS_CHUNK_BASE64;
+
+        // The length is not covered by the checksum, so a corrupt one is caught before anything is allocated for it
+        int encoded = !(flags & GAIUS_FLAG_NO_BASE64) && tag == GAIUS_CHUNK_BASE64;
+        if (len > (encoded ? base64_encoded_size(GAIUS_MAX_FRAMED_CHUNK) : GAIUS_MAX_FRAMED_CHUNK)) {
+            fprintf(stderr, "Error: Corrupt chunk length %zu in chunk %zu at offset %lld in file: %s\n", len, chunk_index, (long long)frame_offset, input_file);
+            status = -1;
+            break;
+        }
+        if (bounded && (off_t)(header_size + len) > input_stat.st_size - frame_offset) {
+            fprintf(stderr, "Error: Truncated chunk %zu at offset %lld in file: %s\n", chunk_index, (long long)frame_offset, input_file);
+            status = -1;
+            break;
+        }
+
+        // Grow the buffers to fit this chunk, chunks may be larger than the local buffer size
+        if (len + 1 > capacity) {
+            free_buffer(buffer, capacity);
+            free_buffer(processed_buffer, capacity);
+            capacity = len + 1;
+            buffer = alloc_buffer(capacity);
+            processed_buffer = alloc_buffer(capacity);
+            if (!buffer || !processed_buffer) {
+                perror("Memory allocation failed for buffers");
+                status = -1;
+                break;
+            }
+        }
+
+        if (fread(buffer, 1, len, input_fp) != len) {
+            fprintf(stderr, "Error: Truncated chunk %zu at offset %lld in file: %s\n", chunk_index, (long long)frame_offset, input_file);
+            status = -1;
+            break;
+        }
+        if (flags & GAIUS_FLAG_CRC32C) {
+            uint32_t crc = (flags & GAIUS_FLAG_ADAPTIVE) ? crc32c(0, &tag, 1) : 0;
+            if (crc32c(crc, buffer, len) != read_le32(frame_header + 4)) {
+                fprintf(stderr, "Error: Checksum mismatch in chunk %zu at offset %lld in file: %s\n", chunk_index, (long long)frame_offset, input_file);
+                status = -1;
+                break;
+            }
+        }
+        buffer[len] = '\0';
+
+        size_t output_length = len;
+        if (encoded) {
+            // Decipher the text and decode Base64 in one pass
+            output_length = substitute_decode(decode_table, table, buffer, len, processed_buffer);
+        } else {
+            apply_table(table, buffer, len, processed_buffer);
+        }
+        if (fwrite(processed_buffer, 1, output_length, output_fp) != output_length) {
+            perror("Error writing output file");
+            status = -1;
+            break;
+        }
+        throttle_chunk(throttle, header_size + len, output_length);
+
+        if (enable_verbosity) {
+            printf("%s chunk %zu (%zu bytes%s) at offset %lld.\n", (flags & GAIUS_FLAG_CRC32C) ? "Verified" : "Read", chunk_index, len,
+                   tag == GAIUS_CHUNK_TEXT ? ", text" : "", (long long)frame_offset);
+        }
+        frame_offset += header_size + len;
+        chunk_index++;
+    }
+
+    free_buffer(buffer, capacity);
+    free_buffer(processed_buffer, capacity);
+    return status;
+}
+
+// Checkpoint journal. A run appends to "<output>.gaius-journal" a settings line, which includes a fingerprint of
+// each target's substitution table so a different key cannot continue it, a "C" record of the committed input
+// and output offsets, with the input's size and modification time, every GAIUS_CHECKPOINT_INTERVAL bytes of a
+// file, and an "F" record once a file's
+// outputs are renamed into place. Watch mode adds an "R" record when a file is written again, undoing its "F".
+// With "-resume" finished files are skipped and unfinished ones continue from their last checkpoint. Records
+// are flushed as they are written, so they outlive the process being killed.
+
+#define GAIUS_JOURNAL_SUFFIX ".gaius-journal"
+#define GAIUS_JOURNAL_HEADER "GAIUS-JOURNAL 2"
+#define GAIUS_TEMP_SUFFIX ".gaius-tmp"
+#define GAIUS_CHECKPOINT_INTERVAL (64 * 1024 * 1024)
+#define JOURNAL_BUCKETS 4096
+
+struct journal_entry {
+    char *input_path;
+    int complete;
+    int has_checkpoint;
+    off_t input_offset;
+    off_t input_size;        // The input when it was checkpointed, a resume of a changed input is refused.
+    long long input_mtime;   // In nanoseconds, see file_mtime_ns().
+    off_t *output_offsets; // One per target.
+    struct journal_entry *next;
+};
+
+struct gaius_journal {
+    char path[1024];
+    FILE *fp;
+    int target_count;
+    struct journal_entry *buckets[JOURNAL_BUCKETS];
+    size_t skipped, resumed;
+    pthread_mutex_t lock; // Held while appending records or counting, watch mode workers share the journal.
+};
+
+// Function to find the journal entry of an input path, creating it if asked to.
+static struct journal_entry *journal_find(struct gaius_journal *journal, const char *input_path, int create) {
+    uint32_t bucket = crc32c(0, (const unsigned char *)input_path, strlen(input_path)) % JOURNAL_BUCKETS;
+    struct journal_entry *entry;
+
+    for (entry = journal->buckets[bucket]; entry; entry = entry->next) {
+        if (strcmp(entry->input_path, input_path) == 0) {
+            return entry;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    entry = calloc(1, sizeof(*entry));
+    if (!entry) {
+        return NULL;
+    }
+    entry->input_path = strdup(input_path);
+    entry->output_offsets = calloc(journal->target_count, sizeof(off_t));
+    if (!entry->input_path || !entry->output_offsets) {
+        free(entry->input_path);
+        free(entry->output_offsets);
+        free(entry);
+        return NULL;
+    }
+    entry->next = journal->buckets[bucket];
+    journal->buckets[bucket] = entry;
+    return entry;
+}
+
+// Function to describe the settings that decide a run's output, a journal only resumes a run with the same ones.
+static void journal_settings(const struct gaius_options *options, char *settings, size_t size) {
+    int target_count = options->decipher ? 1 : options->target_count;
+    int used = snprintf(settings, size, "S %s %zu %d%d%d%d %d", options->mode, options->buffer_size, options->disable_base64,
+                        options->enable_raw, options->enable_crc, options->enable_adaptive, target_count);
+    // The tables stand in for the keys, which are never written down
+    for (int t = 0; t < target_count && used > 0 && (size_t)used < size; t++) {
+        used += snprintf(settings + used, size - used, " %08x", crc32c(0, options->targets[t].table, sizeof(options->targets[t].table)));
+    }
+}
+
+// Function to get a file's modification time in nanoseconds.
+static long long file_mtime_ns(const struct stat *file_stat) {
+#ifdef __APPLE__
+    return (long long)file_stat->st_mtimespec.tv_sec * 1000000000LL + file_stat->st_mtimespec.tv_nsec;
+#else
+    return (long long)file_stat->st_mtim.tv_sec * 1000000000LL + file_stat->st_mtim.tv_nsec;
+#endif
+}
+
+// Function to load the records of an earlier run. Returns -1 if the journal belongs to a different run.
+static int journal_load(struct gaius_journal *journal, const struct gaius_options *options, FILE *fp) {
+    char settings[4096];
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    int line_number = 0, status = 0;
+
+    journal_settings(options, settings, sizeof(settings));
+    while (status == 0 && (length = getline(&line, &capacity, fp)) > 0) {
+        line_number++;
+        // A record without its newline was cut short by the end of the earlier run
+        if (line[length - 1] != '\n') {
+            break;
+        }
+        line[length - 1] = '\0';
+
+        if (line_number == 1) {
+            if (strcmp(line, GAIUS_JOURNAL_HEADER) != 0) {
+                fprintf(stderr, "Error: Not a Gaius journal: %s\n", journal->path);
+                status = -1;
+            }
+        } else if (line[0] == 'S') {
+            if (strcmp(line, settings) != 0) {
+                fprintf(stderr, "Error: Journal %s was written with different settings, run without '-resume' to start over.\n", journal->path);
+                status = -1;
+            }
+        } else if (line[0] == 'F' && line[1] == ' ') {
+            struct journal_entry *entry = journal_find(journal, line + 2, 1);
+            if (entry) {
+                entry->complete = 1;
+            }
+        } else if (line[0] == 'R' && line[1] == ' ') {
+            struct journal_entry *entry = journal_find(journal, line + 2, 0);
+            if (entry) {
+                entry->complete = 0;
+                entry->has_checkpoint = 0;
+            }
+        } else if (line[0] == 'C' && line[1] == ' ') {
+            // Input offset, input size, input modification time, then one offset per target
+            long long values[journal->target_count + 3];
+            char *cursor = line + 2, *end;
+            int valid = 1;
+            for (int i = 0; i < journal->target_count + 3 && valid; i++) {
+                values[i] = strtoll(cursor, &end, 10);
+                valid = end != cursor && *end == ' ' && (values[i] >= 0 || i == 2);
+                cursor = end + 1;
+            }
+            struct journal_entry *entry = valid ? journal_find(journal, cursor, 1) : NULL;
+            if (entry) {
+                entry->has_checkpoint = 1;
+                entry->input_offset = (off_t)values[0];
+                entry->input_size = (off_t)values[1];
+                entry->input_mtime = values[2];
+                for (int t = 0; t < journal->target_count; t++) {
+                    entry->output_offsets[t] = (off_t)values[t + 3];
+                }
+            }
+        }
+    }
+    free(line);
+    return status;
+}
+
+// Function to open the journal of a run beside its output, loading the earlier run's records when resuming.
+struct gaius_journal *journal_open(const struct gaius_options *options, const char *output_path, int resume) {
+    struct gaius_journal *journal = calloc(1, sizeof(*journal));
+    if (!journal) {
+        perror("Memory allocation failed for journal");
+        return NULL;
+    }
+    journal->target_count = options->decipher ? 1 : options->target_count;
+    pthread_mutex_init(&journal->lock, NULL);
+
+    // Keep the journal beside a directory's output, not inside it
+    size_t length = strlen(output_path);
+    while (length > 1 && output_path[length - 1] == '/') {
+        length--;
+    }
+    // Shards of one tree share its output, so each keeps a journal of its own
+    char shard_name[32] = "";
+    if (options->shard) {
+        shard_describe(options->shard, shard_name, sizeof(shard_name));
+    }
+    if (snprintf(journal->path, sizeof(journal->path), "%.*s%s%s", (int)length, output_path, shard_name, GAIUS_JOURNAL_SUFFIX) >= (int)sizeof(journal->path)) {
+        fprintf(stderr, "Error: Output path too long for journal: %s\n", output_path);
+        free(journal);
+        return NULL;
+    }
+
+    FILE *fp = fopen(journal->path, "r");
+    if (fp && resume) {
+        int status = journal_load(journal, options, fp);
+        fclose(fp);
+        if (status != 0) {
+            journal_close(journal, 0);
+            return NULL;
+        }
+        journal->fp = fopen(journal->path, "a");
+    } else {
+        if (fp) {
+            fclose(fp);
+            fprintf(stderr, "Warning: Discarding the journal of an earlier run, use '-resume' to continue it: %s\n", journal->path);
+        } else if (resume) {
+            fprintf(stderr, "Warning: No journal found, starting from the beginning: %s\n", journal->path);
+        }
+        char settings[4096];
+        journal_settings(options, settings, sizeof(settings));
+        journal->fp = fopen(journal->path, "w");
+        if (journal->fp) {
+            fprintf(journal->fp, "%s\n%s\n", GAIUS_JOURNAL_HEADER, settings);
+        }
+    }
+    if (!journal->fp || fflush(journal->fp) != 0) {
+        // Without '-resume' the journal is only insurance, the run itself does not need it
+        perror(resume ? "Error opening journal" : "Warning: Could not create journal, the run cannot be resumed");
+        journal_close(journal, 0);
+        return NULL;
+    }
+    return journal;
+}
+
+// Function to close a journal, removing it once the whole run has succeeded.
+void journal_close(struct gaius_journal *journal, int success) {
+    if (journal->fp) {
+        fclose(journal->fp);
+        if (success) {
+            unlink(journal->path);
+        }
+    }
+    for (int b = 0; b < JOURNAL_BUCKETS; b++) {
+        struct journal_entry *entry = journal->buckets[b];
+        while (entry) {
+            struct journal_entry *next = entry->next;
+            free(entry->output_offsets);
+            free(entry->input_path);
+            free(entry);
+            entry = next;
+        }
+    }
+    pthread_mutex_destroy(&journal->lock);
+    free(journal);
+}
+
+// Function to commit a checkpoint: everything written so far is flushed before its offsets are recorded.
+static int journal_checkpoint(struct gaius_journal *journal, const char *input_file, off_t input_offset,
+                              const struct stat *input_stat, FILE **output_fps, int target_count) {
+    // Paths with a newline cannot be recorded, those files simply start over on resume
+    if (strchr(input_file, '\n')) {
+        return 0;
+    }
+    for (int t = 0; t < target_count; t++) {
+        if (fflush(output_fps[t]) != 0) {
+            perror("Error writing output file");
+            return -1;
+        }
+    }
+    pthread_mutex_lock(&journal->lock);
+    fprintf(journal->fp, "C %lld %lld %lld", (long long)input_offset, (long long)input_stat->st_size, file_mtime_ns(input_stat));
+    for (int t = 0; t < target_count; t++) {
+        fprintf(journal->fp, " %lld", (long long)ftello(output_fps[t]));
+    }
+    fprintf(journal->fp, " %s\n", input_file);
+    int status = fflush(journal->fp);
+    pthread_mutex_unlock(&journal->lock);
+    if (status != 0) {
+        perror("Error writing journal");
+        return -1;
+    }
+    return 0;
+}
+
+// Function to record that a file's outputs are complete and in place.
+static int journal_complete(struct gaius_journal *journal, const char *input_file) {
+    if (strchr(input_file, '\n')) {
+        return 0;
+    }
+    pthread_mutex_lock(&journal->lock);
+    fprintf(journal->fp, "F %s\n", input_file);
+    int status = fflush(journal->fp);
+    pthread_mutex_unlock(&journal->lock);
+    if (status != 0) {
+        perror("Error writing journal");
+        return -1;
+    }
+    return 0;
+}
+
+// Function to record that a finished file was written again, so a resumed run ciphers it over.
+static int journal_reopen(struct gaius_journal *journal, const char *input_file) {
+    if (strchr(input_file, '\n')) {
+        return 0;
+    }
+    pthread_mutex_lock(&journal->lock);
+    fprintf(journal->fp, "R %s\n", input_file);
+    int status = fflush(journal->fp);
+    pthread_mutex_unlock(&journal->lock);
+    if (status != 0) {
+        perror("Error writing journal");
+        return -1;
+    }
+    return 0;
+}
+
+// Function to choose where an output is written until it is complete. A symlink is resolved, so the temporary file
+// sits beside its real target and the rename replaces that instead of the link. Outputs that are not regular
+// files, like /dev/null, outputs below /dev and /proc, and outputs in a directory that cannot be written, are
+// written in place: temp is then the output path itself. Otherwise temp is the real path followed by GAIUS_TEMP_SUFFIX.
+static int output_temp_path(const char *output, char *temp, size_t size) {
+    char resolved[PATH_MAX];
+    struct stat output_stat;
+    const char *real = output;
+
+    // Descriptor links like /dev/stdout lead to files other processes hold open, which must not be replaced
+    if (strncmp(output, "/dev/", 5) == 0 || strncmp(output, "/proc/", 6) == 0) {
+        snprintf(temp, size, "%s", output);
+        return 0;
+    }
+    if (lstat(output, &output_stat) == 0 && S_ISLNK(output_stat.st_mode)) {
+        // A dangling link is followed by fopen() like before
+        if (!realpath(output, resolved) || stat(resolved, &output_stat) != 0) {
+            snprintf(temp, size, "%s", output);
+            return 0;
+        }
+        real = resolved;
+    }
+    if (stat(real, &output_stat) == 0 && !S_ISREG(output_stat.st_mode)) {
+        snprintf(temp, size, "%s", output);
+        return 0;
+    }
+
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", real);
+    char *slash = strrchr(dir, '/');
+    if (slash == dir) {
+        slash[1] = '\0';
+    } else if (slash) {
+        *slash = '\0';
+    } else {
+        strcpy(dir, ".");
+    }
+    if (access(dir, W_OK | X_OK) != 0) {
+        snprintf(temp, size, "%s", output);
+        return 0;
+    }
+    if (snprintf(temp, size, "%s%s", real, GAIUS_TEMP_SUFFIX) >= (int)size) {
+        fprintf(stderr, "Error: Output path too long: %s\n", output);
+        return -1;
+    }
+    return 0;
+}
+
+// Function to rename each temporary output of a file into place on success, removing it on failure, and record the
+// file as done in the journal. A temporary output replaces the path it was named after, taking over the mode and
+// owner of the file it replaces unless it is a hardlink of another output.
+static int commit_outputs(const struct gaius_options *options, const char *input_file, char (*temp_files)[1024],
+                          const char *const *output_files, int target_count, int status) {
+    for (int t = 0; t < target_count; t++) {
+        // Outputs written in place, see output_temp_path()
+        if (strcmp(temp_files[t], output_files[t]) == 0) {
+            continue;
+        }
+        char final_path[PATH_MAX];
+        snprintf(final_path, sizeof(final_path), "%.*s", (int)(strlen(temp_files[t]) - strlen(GAIUS_TEMP_SUFFIX)), temp_files[t]);
+        struct stat old_stat, temp_stat;
+        if (status == 0 && stat(final_path, &old_stat) == 0 && stat(temp_files[t], &temp_stat) == 0 && temp_stat.st_nlink == 1) {
+            // The owner can only be given away by root, anyone else keeps their own
+            if (chown(temp_files[t], old_stat.st_uid, old_stat.st_gid) != 0 && errno != EPERM) {
+                perror("Warning: Could not keep output file owner");
+            }
+            if (chmod(temp_files[t], old_stat.st_mode & 07777) != 0) {
+                perror("Warning: Could not keep output file mode");
+            }
+        }
+        if (status == 0 && rename(temp_files[t], final_path) != 0) {
+            perror("Error renaming output file");
+            status = -1;
+        }
+        if (status != 0) {
+            unlink(temp_files[t]);
+        }
+    }
+    if (status == 0 && options->journal && journal_complete(options->journal, input_file) != 0) {
+        status = -1;
+    }
+    return status;
+}
+
+// Function to close a file's outputs and commit them, see commit_outputs().
+static int finish_outputs(const struct gaius_options *options, const char *input_file, FILE **output_fps,
+                          char (*temp_files)[1024], const char *const *output_files, int target_count, int status) {
+    for (int t = 0; t < target_count; t++) {
+        if (fclose(output_fps[t]) != 0 && status == 0) {
+            perror("Error writing output file");
+            status = -1;
+        }
+    }
+    return commit_outputs(options, input_file, temp_files, output_files, target_count, status);
+}
+
+// Direct I/O for "-direct", bypassing the page cache on both sides. Input is read with O_DIRECT in large aligned
+// blocks and chunks are handed to the pipeline straight out of the read buffer. Output is a stdio stream whose
+// writes are gathered into aligned blocks, so everything that writes a FILE works unchanged; the final partial
+// block is padded for the write and the file is truncated back to its real length.
+
+#define DIRECT_ALIGN 4096                  // Offset and memory alignment, enough for 512 byte and 4K sector devices.
+#define DIRECT_IO_SIZE (4 * 1024 * 1024)   // Smallest transfer, rounded up to a multiple of the file's preferred I/O size.
+
+struct direct_reader {
+    int fd;
+    unsigned char *buffer;
+    size_t capacity;
+    size_t start, end; // Unread bytes.
+    size_t io_size;
+    int eof;
+};
+
+struct direct_writer {
+    int fd;
+    unsigned char *buffer;
+    size_t capacity; // One transfer, a multiple of DIRECT_ALIGN.
+    size_t length;   // Bytes gathered, not yet written as a full block.
+    off_t offset;    // File offset of buffer[0], always aligned.
+};
+
+// Function to round up to a multiple of DIRECT_ALIGN.
+static size_t direct_align_up(size_t size) {
+    return (size + DIRECT_ALIGN - 1) & ~((size_t)DIRECT_ALIGN - 1);
+}
+
+// Function to size transfers for the file's preferred I/O size, in whole aligned blocks.
+static size_t direct_io_size(int fd) {
+    struct stat st;
+    size_t unit = DIRECT_ALIGN;
+    if (fstat(fd, &st) == 0 && st.st_blksize > 0 && (size_t)st.st_blksize % DIRECT_ALIGN == 0) {
+        unit = st.st_blksize;
+    }
+    return (DIRECT_IO_SIZE + unit - 1) / unit * unit;
+}
+
+// Function to turn O_DIRECT off on a descriptor whose filesystem accepted the flag but rejects the I/O.
+static int direct_fallback(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || !(flags & O_DIRECT)) {
+        return -1;
+    }
+    fprintf(stderr, "Warning: Direct I/O rejected by the filesystem, continuing with buffered I/O.\n");
+    return fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+}
+
+// Function to open a file for direct reads of chunks up to chunk_size bytes. Returns -1 if direct I/O is unavailable.
+static int direct_reader_open(struct direct_reader *reader, const char *path, size_t chunk_size) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = open(path, O_RDONLY | O_DIRECT);
+    if (reader->fd < 0) {
+        return -1;
+    }
+    // Room for an unread remainder slid to end on an aligned offset, plus one transfer after it
+    reader->io_size = direct_io_size(reader->fd);
+    reader->capacity = direct_align_up(chunk_size) + reader->io_size;
+    if (posix_memalign((void **)&reader->buffer, DIRECT_ALIGN, reader->capacity) != 0) {
+        close(reader->fd);
+        reader->fd = -1;
+        reader->buffer = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Function to start reading at an arbitrary offset, reading from the aligned offset below it.
+static int direct_reader_seek(struct direct_reader *reader, off_t offset) {
+    off_t aligned = offset & ~((off_t)DIRECT_ALIGN - 1);
+    if (lseek(reader->fd, aligned, SEEK_SET) != aligned) {
+        return -1;
+    }
+    reader->start = reader->end = 0;
+    reader->eof = 0;
+    while (reader->end < (size_t)(offset - aligned) && !reader->eof) {
+        ssize_t n = read(reader->fd, reader->buffer + reader->end, reader->io_size);
+        if (n < 0) {
+            if (errno == EINTR || (errno == EINVAL && direct_fallback(reader->fd) == 0)) {
+                continue;
+            }
+            return -1;
+        }
+        reader->end += n;
+        reader->eof = (size_t)n < reader->io_size;
+    }
+    reader->start = (size_t)(offset - aligned) < reader->end ? (size_t)(offset - aligned) : reader->end;
+    return 0;
+}
+
+// Function to get the next chunk of up to want bytes, pointing data into the read buffer. Returns -1 on error.
+static ssize_t direct_read(struct direct_reader *reader, size_t want, unsigned char **data) {
+    while (reader->end - reader->start < want && !reader->eof) {
+        // Slide what is left so it ends on an aligned address, where the next transfer lands
+        size_t remaining = reader->end - reader->start;
+        size_t head = direct_align_up(remaining) - remaining;
+        if (reader->start != head) {
+            memmove(reader->buffer + head, reader->buffer + reader->start, remaining);
+            reader->start = head;
+            reader->end = head + remaining;
+        }
+        ssize_t n = read(reader->fd, reader->buffer + reader->end, reader->io_size);
+        if (n < 0) {
+            if (errno == EINTR || (errno == EINVAL && direct_fallback(reader->fd) == 0)) {
+                continue;
+            }
+            perror("Error reading input file");
+            return -1;
+        }
+        // A short transfer only happens at the end of the file
+        reader->end += n;
+        reader->eof = (size_t)n < reader->io_size;
+    }
+    size_t length = reader->end - reader->start < want ? reader->end - reader->start : want;
+    *data = reader->buffer + reader->start;
+    reader->start += length;
+    return (ssize_t)length;
+}
+
+// Function to release a direct reader.
+static void direct_reader_close(struct direct_reader *reader) {
+    if (reader->fd >= 0) {
+        close(reader->fd);
+    }
+    free(reader->buffer);
+}
+
+// Function to write size bytes of the gathered block, a multiple of DIRECT_ALIGN, at the writer's offset.
+static int direct_pwrite(struct direct_writer *writer, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = pwrite(writer->fd, writer->buffer + written, size - written, writer->offset + written);
+        if (n < 0) {
+            if (errno == EINTR || (errno == EINVAL && direct_fallback(writer->fd) == 0)) {
+                continue;
+            }
+            return -1;
+        }
+        written += n;
+    }
+    return 0;
+}
+
+// Function to gather writes of the output stream, writing each block once it is full.
+static ssize_t direct_writer_write(void *cookie, const char *data, size_t size) {
+    struct direct_writer *writer = cookie;
+    size_t done = 0;
+    while (done < size) {
+        size_t n = size - done < writer->capacity - writer->length ? size - done : writer->capacity - writer->length;
+        memcpy(writer->buffer + writer->length, data + done, n);
+        writer->length += n;
+        done += n;
+        if (writer->length == writer->capacity) {
+            if (direct_pwrite(writer, writer->capacity) != 0) {
+                return -1;
+            }
+            writer->offset += writer->capacity;
+            writer->length = 0;
+        }
+    }
+    return (ssize_t)size;
+}
+
+// Function to report the stream position, the only seek an output stream needs.
+static int direct_writer_seek(void *cookie, off64_t *position, int whence) {
+    struct direct_writer *writer = cookie;
+    if (whence != SEEK_CUR || *position != 0) {
+        errno = ESPIPE;
+        return -1;
+    }
+    *position = writer->offset + writer->length;
+    return 0;
+}
+
+// Function to write out the gathered partial block, padded to an aligned size. It stays gathered, and is written
+// again in full once it fills. Used before a checkpoint, so everything up to the stream position is in the file.
+static int direct_writer_sync(struct direct_writer *writer) {
+    if (writer->length == 0) {
+        return 0;
+    }
+    size_t padded = direct_align_up(writer->length);
+    memset(writer->buffer + writer->length, 0, padded - writer->length);
+    return direct_pwrite(writer, padded);
+}
+
+// Function to write the tail of the output and trim the padding off the file.
+static int direct_writer_close(void *cookie) {
+    struct direct_writer *writer = cookie;
+    int status = direct_writer_sync(writer);
+    if (status == 0 && ftruncate(writer->fd, writer->offset + writer->length) != 0) {
+        status = -1;
+    }
+    if (close(writer->fd) != 0) {
+        status = -1;
+    }
+    free(writer->buffer);
+    free(writer);
+    return status;
+}
+
+// Function to open an output stream written with O_DIRECT. A resumed output continues at resume_offset, any
+// other is truncated. Returns NULL if direct I/O is unavailable, with errno set.
+static FILE *direct_writer_open(const char *path, off_t resume_offset, struct direct_writer **writer_out) {
+    struct direct_writer *writer = calloc(1, sizeof(*writer));
+    if (!writer) {
+        return NULL;
+    }
+    writer->fd = open(path, O_RDWR | O_CREAT | O_DIRECT | (resume_offset < 0 ? O_TRUNC : 0), 0644);
+    if (writer->fd < 0) {
+        free(writer);
+        return NULL;
+    }
+    writer->capacity = direct_io_size(writer->fd);
+    if (posix_memalign((void **)&writer->buffer, DIRECT_ALIGN, writer->capacity) != 0) {
+        close(writer->fd);
+        free(writer);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    // Continue inside the block holding the resume offset, with its head read back
+    if (resume_offset > 0) {
+        writer->offset = resume_offset & ~((off_t)DIRECT_ALIGN - 1);
+        writer->length = resume_offset - writer->offset;
+        if (ftruncate(writer->fd, resume_offset) != 0 ||
+            (writer->length && pread(writer->fd, writer->buffer, DIRECT_ALIGN, writer->offset) < (ssize_t)writer->length)) {
+            int saved = errno;
+            close(writer->fd);
+            free(writer->buffer);
+            free(writer);
+            errno = saved;
+            return NULL;
+        }
+    }
+
+    cookie_io_functions_t functions = {NULL, direct_writer_write, direct_writer_seek, direct_writer_close};
+    FILE *fp = fopencookie(writer, "w", functions);
+    if (!fp) {
+        close(writer->fd);
+        free(writer->buffer);
+        free(writer);
+        return NULL;
+    }
+    // Writes go straight to the gathering buffer, stdio buffering would only add a copy
+    setvbuf(fp, NULL, _IONBF, 0);
+    *writer_out = writer;
+    return fp;
+}
+
+// The per-chunk work of process_file(), as a pipeline of stages chosen once per file instead of branches
+// taken on every chunk. Stages hand data on by swapping buffer pointers rather than copying, and adjacent
+// passes are fused where a table can do both: Base64 and substitution run as one lookup per symbol.
+// Shared stages run once per chunk, per-target stages once for every target on a view of the chunk.
+
+#define PIPELINE_MAX_STAGES 4
+
+// A chunk moving through a pipeline.
+struct chunk {
+    unsigned char *data;
+    size_t length;
+    unsigned char *spare; // Buffer a stage writes into, then swaps with data.
+    unsigned char tag;    // GAIUS_CHUNK_BASE64, or GAIUS_CHUNK_TEXT for printable chunks in adaptive mode.
+};
+
+struct pipeline;
+typedef int (*pipeline_stage)(struct pipeline *pipeline, const struct gaius_target *target, FILE *output_fp, struct chunk *chunk);
+
+struct pipeline {
+    pipeline_stage shared[PIPELINE_MAX_STAGES];
+    int shared_count;
+    // A view's spare is the pipeline's target buffer and its data the shared chunk, which later targets still
+    // need, so only the first per-target stage may swap, the ones after it work in place.
+    pipeline_stage per_target[PIPELINE_MAX_STAGES];
+    int per_target_count;
+    uint16_t frame_flags;
+    unsigned char *target_buffer;
+    size_t written; // Bytes written for the current chunk, over all targets.
+};
+
+// Function to hand a stage's output on, making the buffer it wrote the chunk's data.
+static void chunk_swap(struct chunk *chunk, size_t length) {
+    unsigned char *data = chunk->data;
+    chunk->data = chunk->spare;
+    chunk->spare = data;
+    chunk->length = length;
+}
+
+// Stage: tag printable chunks so they skip Base64.
+static int stage_classify(struct pipeline *pipeline, const struct gaius_target *target, FILE *output_fp, struct chunk *chunk) {
+    (void)pipeline, (void)target, (void)output_fp;
+    chunk->tag = is_printable_text(chunk->data, chunk->length) ? GAIUS_CHUNK_TEXT : GAIUS_CHUNK_BASE64;
+    return 0;
+}
+
+// Stage: substitute through the target's letter or raw byte table.
+static int stage_substitute(struct pipeline *pipeline, const struct gaius_target *target, FILE *output_fp, struct chunk *chunk) {
+    (void)pipeline, (void)output_fp;
+    apply_table(target->table, chunk->data, chunk->length, chunk->spare);
+    chunk_swap(chunk, chunk->length);
+    return 0;
+}
+
+// Stage: Base64-encode and substitute fused, printable chunks in adaptive mode are only substituted.
+static int stage_encode_substitute(struct pipeline *pipeline, const struct gaius_target *target, FILE *output_fp, struct chunk *chunk) {
+    if (chunk->tag == GAIUS_CHUNK_TEXT) {
+        return stage_substitute(pipeline, target, output_fp, chunk);
+    }
+    chunk_swap(chunk, encode_substitute(target->encode_table, target->table, chunk->data, chunk->length, chunk->spare));
+    return 0;
+}
+
+// Stage: substitute and Base64-decode fused.
+static int stage_substitute_decode(struct pipeline *pipeline, const struct gaius_target *target, FILE *output_fp, struct chunk *chunk) {
+    (void)pipeline, (void)output_fp;
+    chunk_swap(chunk, substitute_decode(target->decode_table, target->table, chunk->data, chunk->length, chunk->spare));
+    return 0;
+}
+
+// Stage: write the chunk as it is.
+static int stage_write(struct pipeline *pipeline, const struct gaius_target *target, FILE *output_fp, struct chunk *chunk) {
+    (void)target;
+    if (fwrite(chunk->data, 1, chunk->length, output_fp) != chunk->length) {
+        perror("Error writing output file");
+        return -1;
+    }
+    pipeline->written += chunk->length;
+    return 0;
+}
+
+// Stage: write the chunk as a frame, checksummed and tagged as the format flags call for.
+static int stage_write_frame(struct pipeline *pipeline, const struct gaius_target *target, FILE *output_fp, struct chunk *chunk) {
+    (void)target;
+    if (write_frame(output_fp, pipeline->frame_flags, chunk->tag, chunk->data, chunk->length) != 0) {
+        perror("Error writing output file");
+        return -1;
+    }
+    pipeline->written += frame_header_size(pipeline->frame_flags) + chunk->length;
+    return 0;
+}
+
+// Function to choose a file's stages: [classify] -> encode and substitute | substitute [and decode] -> write [framed].
+static void pipeline_build(struct pipeline *pipeline, const struct gaius_options *options, uint16_t frame_flags, unsigned char *target_buffer) {
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->frame_flags = frame_flags;
+    pipeline->target_buffer = target_buffer;
+
+    if (options->enable_adaptive && !options->decipher) {
+        pipeline->shared[pipeline->shared_count++] = stage_classify;
+    }
+    if (options->disable_base64) {
+        pipeline->per_target[pipeline->per_target_count++] = stage_substitute;
+    } else {
+        pipeline->per_target[pipeline->per_target_count++] = options->decipher ? stage_substitute_decode : stage_encode_substitute;
+    }
+    pipeline->per_target[pipeline->per_target_count++] = frame_flags ? stage_write_frame : stage_write;
+}
+
+// Function to run one chunk through the pipeline into every target's output.
+static int pipeline_run(struct pipeline *pipeline, const struct gaius_target *targets, FILE **output_fps, int target_count, struct chunk *chunk) {
+    pipeline->written = 0;
+    for (int s = 0; s < pipeline->shared_count; s++) {
+        if (pipeline->shared[s](pipeline, NULL, NULL, chunk) != 0) {
+            return -1;
+        }
+    }
+    for (int t = 0; t < target_count; t++) {
+        struct chunk view = *chunk;
+        view.spare = pipeline->target_buffer;
+        for (int s = 0; s < pipeline->per_target_count; s++) {
+            if (pipeline->per_target[s](pipeline, &targets[t], output_fps[t], &view) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Function to process a single file. Deciphering uses the first target only, enciphering
+// reads and Base64-encodes each chunk once and writes it through every target's table.
+int process_file(const struct gaius_options *options, const char *input_file, const char *const *output_files) {
+    const struct gaius_target *targets = options->targets;
+    int target_count = options->decipher ? 1 : options->target_count;
+    int disable_base64 = options->disable_base64;
+    int enable_crc = options->enable_crc;
+    uint16_t frame_flags = 0;
+    size_t buffer_size = options->buffer_size;
+
+    if (options->enable_verbosity) {
+        printf("Processing file: %s\n", input_file);
+        for (int t = 0; t < target_count; t++) {
+            printf("Output file: %s\n", output_files[t]);
+        }
+        printf("Mode: %s\n", options->mode);
+        printf("Base64 Encoding Disabled: %s\n", disable_base64 ? "Yes" : "No");
+        printf("Raw Byte Mode: %s\n", options->enable_raw ? "Yes" : "No");
+        printf("Checksums Enabled: %s\n", enable_crc ? "Yes" : "No");
+        printf("Buffer Size: %zu bytes\n", buffer_size);
+    }
+
+    // Files finished by an earlier run are skipped, unfinished ones continue from their last checkpoint
+    struct journal_entry *checkpoint = options->journal ? journal_find(options->journal, input_file, 0) : NULL;
+    if (checkpoint && checkpoint->complete) {
+        if (options->enable_verbosity) {
+            printf("Skipping file completed by an earlier run: %s\n", input_file);
+        }
+        pthread_mutex_lock(&options->journal->lock);
+        options->journal->skipped++;
+        pthread_mutex_unlock(&options->journal->lock);
+        return 0;
+    }
+
+    // Outputs are written under a temporary name and renamed into place once complete
+    char temp_files[target_count][1024];
+    int resuming = checkpoint && checkpoint->has_checkpoint;
+    for (int t = 0; t < target_count; t++) {
+        struct stat output_stat;
+        if (output_temp_path(output_files[t], temp_files[t], sizeof(temp_files[t])) != 0) {
+            return -1;
+        }
+        if (strcmp(temp_files[t], output_files[t]) == 0) {
+            resuming = 0;
+        }
+        // A checkpoint is only usable while the output it describes is still there
+        if (resuming && (stat(temp_files[t], &output_stat) != 0 || output_stat.st_size < checkpoint->output_offsets[t])) {
+            resuming = 0;
+        }
+    }
+
+    // Open input and output files
+    FILE *input_fp = fopen(input_file, "rb");
+    if (!input_fp) {
+        perror("Error opening input file");
+        return -1;
+    }
+    // A checkpoint only describes the input as it was, anything else would splice two versions together
+    struct stat opened_stat;
+    if (fstat(fileno(input_fp), &opened_stat) != 0) {
+        perror("Error reading input file");
+        fclose(input_fp);
+        return -1;
+    }
+    if (resuming && (opened_stat.st_size != checkpoint->input_size || file_mtime_ns(&opened_stat) != checkpoint->input_mtime)) {
+        fprintf(stderr, "Error: Input changed since its checkpoint, run without '-resume' to start over: %s\n", input_file);
+        fclose(input_fp);
+        return -1;
+    }
+
+    FILE *output_fps[target_count];
+    struct direct_writer *direct_writers[target_count];
+    for (int t = 0; t < target_count; t++) {
+        direct_writers[t] = NULL;
+        if (options->direct_io && strcmp(temp_files[t], output_files[t]) != 0) {
+            output_fps[t] = direct_writer_open(temp_files[t], resuming ? checkpoint->output_offsets[t] : -1, &direct_writers[t]);
+            if (output_fps[t]) {
+                continue;
+            }
+            if (errno != EINVAL) {
+                perror("Error opening output file");
+                while (t-- > 0) {
+                    fclose(output_fps[t]);
+                }
+                fclose(input_fp);
+                return -1;
+            }
+            fprintf(stderr, "Warning: Direct I/O not supported for %s, using buffered I/O.\n", temp_files[t]);
+        }
+        output_fps[t] = fopen(temp_files[t], resuming ? "r+b" : "wb");
+        // Drop whatever was written after the checkpoint
+        if (output_fps[t] && resuming && (ftruncate(fileno(output_fps[t]), checkpoint->output_offsets[t]) != 0 ||
+                                          fseeko(output_fps[t], checkpoint->output_offsets[t], SEEK_SET) != 0)) {
+            fclose(output_fps[t]);
+            output_fps[t] = NULL;
+        }
+        if (!output_fps[t]) {
+            perror("Error opening output file");
+            while (t-- > 0) {
+                fclose(output_fps[t]);
+            }
+            fclose(input_fp);
+            return -1;
+        }
+    }
+
+    int status = 0;
+
+    if (!options->decipher && (enable_crc || options->enable_adaptive)) {
+        frame_flags = (enable_crc ? GAIUS_FLAG_CRC32C : 0) | (disable_base64 ? GAIUS_FLAG_NO_BASE64 : 0) |
+                      (options->enable_raw ? GAIUS_FLAG_RAW : 0) | (options->enable_adaptive ? GAIUS_FLAG_ADAPTIVE : 0);
+        // A resumed output already starts with its header
+        for (int t = 0; t < target_count && status == 0 && !resuming; t++) {
+            if (write_frame_header(output_fps[t], frame_flags) != 0) {
+                perror("Error writing output file");
+                status = -1;
+            }
+        }
+    } else if (options->decipher) {
+        // Framed files carry their own settings, and are verified chunk by chunk
+        uint16_t flags = 0;
+        int framed = read_frame_header(input_fp, &flags);
+        if (framed < 0) {
+            fprintf(stderr, "Error: Unsupported format version in file: %s\n", input_file);
+            status = -1;
+        } else if (framed) {
+            status = decipher_framed_file(input_fp, output_fps[0], input_file, targets[0].keyword, targets[0].mixed_alphabet,
+                                          flags, options->enable_verbosity, options->throttle);
+            progress_add(options->progress, ftello(input_fp));
+        } else if (enable_crc) {
+            fprintf(stderr, "Warning: No checksums present in file: %s\n", input_file);
+        }
+        if (framed != 0) {
+            // Framed files are never checkpointed, so there is no partial output to continue
+            if (options->enable_verbosity && status == 0) {
+                printf("File processing complete. Output written to: %s\n", output_files[0]);
+            }
+            fclose(input_fp);
+            return finish_outputs(options, input_file, output_fps, temp_files, output_files, target_count, status);
+        }
+    }
+
+    // When deciphering Base64 output, read exactly one enciphered chunk at a time so chunk boundaries line up
+    size_t read_size = buffer_size;
+    size_t processed_size = buffer_size + 1;
+    if (!disable_base64) {
+        if (options->decipher) {
+            read_size = base64_encoded_size(buffer_size);
+        }
+        processed_size = base64_encoded_size(buffer_size) + 1;
+    }
+    // Direct input hands out chunks from its own aligned buffer
+    struct direct_reader reader = {.fd = -1};
+    if (options->direct_io && status == 0 && direct_reader_open(&reader, input_file, read_size) != 0) {
+        fprintf(stderr, "Warning: Direct I/O not supported for %s, using buffered I/O.\n", input_file);
+    }
+
+    unsigned char *buffer = reader.fd < 0 ? alloc_buffer(read_size + 1) : NULL;
+    unsigned char *processed_buffer = alloc_buffer(processed_size);
+    if ((!buffer && reader.fd < 0) || !processed_buffer || status != 0) {
+        if (status == 0) {
+            perror("Memory allocation failed for buffers");
+        }
+        free_buffer(buffer, read_size + 1);
+        free_buffer(processed_buffer, processed_size);
+        direct_reader_close(&reader);
+        fclose(input_fp);
+        return finish_outputs(options, input_file, output_fps, temp_files, output_files, target_count, -1);
+    }
+
+    // Without Base64 or framing every byte maps to exactly one byte and NUL maps to NUL, so only
+    // the data extents of a sparse input need processing and its holes can stay holes in the output
+    // Extents are probed on a descriptor of their own, so the stdio stream's offset is never disturbed
+    int sparse = disable_base64 && !frame_flags && reader.fd < 0;
+    int input_fd = sparse ? open(input_file, O_RDONLY) : -1;
+    struct stat input_stat;
+    off_t position = 0, extent_end = 0, last_checkpoint = 0, counted = 0;
+    if (sparse && (input_fd < 0 || fstat(input_fd, &input_stat) != 0 || !S_ISREG(input_stat.st_mode) ||
+                   (lseek(input_fd, 0, SEEK_DATA) < 0 && errno == EINVAL))) {
+        sparse = 0;
+    }
+    // Holes are left by seeking the outputs and set their size by truncating, so every output must be a regular file
+    for (int t = 0; t < target_count && sparse; t++) {
+        struct stat output_stat;
+        if (fileno(output_fps[t]) < 0 || fstat(fileno(output_fps[t]), &output_stat) != 0 || !S_ISREG(output_stat.st_mode)) {
+            sparse = 0;
+        }
+    }
+
+    // Checkpoints fall on chunk boundaries, so the input continues exactly where the outputs stopped
+    if (resuming) {
+        if (reader.fd >= 0 ? direct_reader_seek(&reader, checkpoint->input_offset) != 0 : fseeko(input_fp, checkpoint->input_offset, SEEK_SET) != 0) {
+            perror("Error seeking input file");
+            status = -1;
+        }
+        position = last_checkpoint = checkpoint->input_offset;
+        pthread_mutex_lock(&options->journal->lock);
+        options->journal->resumed++;
+        pthread_mutex_unlock(&options->journal->lock);
+        if (options->enable_verbosity) {
+            printf("Resuming file at offset %lld: %s\n", (long long)position, input_file);
+        }
+    }
+
+    struct pipeline pipeline;
+    pipeline_build(&pipeline, options, frame_flags, processed_buffer);
+
+    size_t bytes_read, want = read_size;
+
+    while (status == 0) {
+        if (sparse) {
+            if (position >= extent_end) {
+                // Skip to the next data extent, ENXIO means the rest of the file is a hole
+                off_t data_start = lseek(input_fd, position, SEEK_DATA);
+                if (data_start < 0) {
+                    if (errno != ENXIO) {
+                        perror("Error reading input file");
+                        status = -1;
+                    }
+                    break;
+                }
+                extent_end = lseek(input_fd, data_start, SEEK_HOLE);
+                if (extent_end < 0) {
+                    perror("Error reading input file");
+                    status = -1;
+                    break;
+                }
+                if (data_start > position) {
+                    if (options->enable_verbosity) {
+                        printf("Skipping hole of %lld bytes at offset %lld.\n", (long long)(data_start - position), (long long)position);
+                    }
+                    position = data_start;
+                    if (fseeko(input_fp, position, SEEK_SET) != 0) {
+                        perror("Error seeking input file");
+                        status = -1;
+                        break;
+                    }
+                    for (int t = 0; t < target_count && status == 0; t++) {
+                        if (fseeko(output_fps[t], position, SEEK_SET) != 0) {
+                            perror("Error seeking output file");
+                            status = -1;
+                        }
+                    }
+                    if (status != 0) {
+                        break;
+                    }
+                }
+            }
+            want = (size_t)(extent_end - position) < read_size ? (size_t)(extent_end - position) : read_size;
+        }
+        unsigned char *data = buffer;
+        if (reader.fd >= 0) {
+            ssize_t n = direct_read(&reader, want, &data);
+            if (n < 0) {
+                status = -1;
+                break;
+            }
+            bytes_read = n;
+        } else {
+            bytes_read = fread(buffer, 1, want, input_fp);
+        }
+        if (bytes_read == 0) {
+            break;
+        }
+        position += bytes_read;
+
+        struct chunk chunk = {data, bytes_read, NULL, GAIUS_CHUNK_BASE64};
+        if (pipeline_run(&pipeline, targets, output_fps, target_count, &chunk) != 0) {
+            status = -1;
+            break;
+        }
+        throttle_chunk(options->throttle, bytes_read, pipeline.written);
+        // Holes skipped and the part of a resumed file done earlier count as done too
+        progress_add(options->progress, position - counted);
+        counted = position;
+
+        if (options->enable_verbosity) {
+            printf("Processed %zu bytes from input file.\n", bytes_read);
+        }
+
+        if (options->journal && position - last_checkpoint >= GAIUS_CHECKPOINT_INTERVAL) {
+            for (int t = 0; t < target_count && status == 0; t++) {
+                if (direct_writers[t] && direct_writer_sync(direct_writers[t]) != 0) {
+                    perror("Error writing output file");
+                    status = -1;
+                }
+            }
+            if (status == 0 && journal_checkpoint(options->journal, input_file, position, &opened_stat, output_fps, target_count) != 0) {
+                status = -1;
+            }
+            last_checkpoint = position;
+        }
+    }
+
+    if (input_fd >= 0) {
+        close(input_fd);
+    }
+
+    // Restore the apparent size, recreating a trailing hole
+    if (sparse && status == 0) {
+        for (int t = 0; t < target_count; t++) {
+            if (fflush(output_fps[t]) != 0 || ftruncate(fileno(output_fps[t]), input_stat.st_size) != 0) {
+                perror("Error writing output file");
+                status = -1;
+            }
+        }
+        progress_add(options->progress, input_stat.st_size - counted);
+    }
+
+    if (ferror(input_fp)) {
+        perror("Error reading input file");
+        status = -1;
+    }
+
+    if (options->enable_verbosity && status == 0) {
+        for (int t = 0; t < target_count; t++) {
+            printf("File processing complete. Output written to: %s\n", output_files[t]);
+        }
+    }
+
+    // Cleanup
+    free_buffer(buffer, read_size + 1);
+    free_buffer(processed_buffer, processed_size);
+    direct_reader_close(&reader);
+    fclose(input_fp);
+    return finish_outputs(options, input_file, output_fps, temp_files, output_files, target_count, status);
+}
+
+// Record mode. Every newline-delimited line is ciphered on its own, Base64 per line when enabled, and
+// written with its newline, so a consumer can act on each record as soon as it arrives. Output is batched
+// while more input is already waiting and written out as soon as the reader catches up, or at the latest
+// GAIUS_LINE_FLUSH_WINDOW_NS after the oldest unwritten record.
+
+#define GAIUS_LINE_FLUSH_WINDOW_NS 1000000L // 1 ms.
+#define GAIUS_FOLLOW_INTERVAL_NS 10000000L  // Poll interval for growing files when inotify is unavailable.
+
+// Pending output of one target in record mode.
+struct line_output {
+    int fd;
+    unsigned char *data;
+    size_t length;
+    size_t capacity;
+};
+
+// Function to write out a target's pending records.
+static int line_flush(struct line_output *output) {
+    size_t written = 0;
+    while (written < output->length) {
+        ssize_t n = write(output->fd, output->data + written, output->length - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error writing output file");
+            return -1;
+        }
+        written += n;
+    }
+    output->length = 0;
+    return 0;
+}
+
+// Function to make room for need more bytes of output, writing out pending records or growing the buffer.
+static int line_reserve(struct line_output *output, size_t need) {
+    if (output->length + need <= output->capacity) {
+        return 0;
+    }
+    if (line_flush(output) != 0) {
+        return -1;
+    }
+    if (need > output->capacity) {
+        unsigned char *data = realloc(output->data, need);
+        if (!data) {
+            perror("Memory allocation failed for buffers");
+            return -1;
+        }
+        output->data = data;
+        output->capacity = need;
+    }
+    return 0;
+}
+
+// Function to grow a scratch buffer to at least size bytes.
+static int line_grow(unsigned char **buffer, size_t *capacity, size_t size) {
+    if (size <= *capacity) {
+        return 0;
+    }
+    unsigned char *grown = realloc(*buffer, size);
+    if (!grown) {
+        perror("Memory allocation failed for buffers");
+        return -1;
+    }
+    *buffer = grown;
+    *capacity = size;
+    return 0;
+}
+
+// Function to wait for a followed file to grow, using inotify where available.
+static void wait_for_growth(int watch_fd) {
+#ifdef __linux__
+    if (watch_fd >= 0) {
+        char events[4096];
+        if (read(watch_fd, events, sizeof(events)) > 0) {
+            return;
+        }
+    }
+#endif
+    struct timespec interval = {0, GAIUS_FOLLOW_INTERVAL_NS};
+    nanosleep(&interval, NULL);
+}
+
+// Field selection in record mode. Only the selected CSV columns or top-level JSON keys are ciphered, every
+// other byte of the record is copied as is. With Base64 the selected field's raw text, quotes included, is
+// encoded and substituted, so deciphering restores it byte for byte; JSON values are written back as strings
+// so the record stays valid. Without Base64 letters are substituted in place, skipping JSON escape sequences.
+
+#define FIELDS_CSV 1
+#define FIELDS_JSONL 2
+
+struct field_selection {
+    int format;
+    int header;          // CSV columns were given by name, the first record names them and is kept as is.
+    int count;
+    char **names;        // Selected columns or keys, as given on the command line.
+    long *columns;       // 0-based CSV column of each selected name, -1 until the header is read.
+};
+
+// Function to append bytes to a target's pending output.
+static int line_append(struct line_output *output, const unsigned char *data, size_t length) {
+    if (line_reserve(output, length) != 0) {
+        return -1;
+    }
+    memcpy(output->data + output->length, data, length);
+    output->length += length;
+    return 0;
+}
+
+// Function to substitute the letters inside JSON strings, leaving escape sequences and everything outside strings alone.
+static void json_substitute(const unsigned char *table, const unsigned char *input, size_t len, unsigned char *output) {
+    int in_string = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char ch = input[i];
+        output[i] = ch;
+        if (!in_string) {
+            in_string = ch == '"';
+        } else if (ch == '\\') {
+            // Copy the escaped character, and the four hex digits of a \u escape
+            size_t escape_end = i + 1 < len && input[i + 1] == 'u' ? i + 5 : i + 1;
+            for (; i < escape_end && i + 1 < len; i++) {
+                output[i + 1] = input[i + 1];
+            }
+        } else if (ch == '"') {
+            in_string = 0;
+        } else {
+            output[i] = table[ch];
+        }
+    }
+}
+
+// Function to cipher one selected field into a target's pending output.
+static int field_cipher(const struct gaius_options *options, const unsigned char *table, struct line_output *output,
+                        const unsigned char *value, size_t length, unsigned char **scratch, size_t *scratch_capacity) {
+    int json = options->fields->format == FIELDS_JSONL;
+
+    if (options->disable_base64) {
+        if (line_reserve(output, length) != 0) {
+            return -1;
+        }
+        if (json) {
+            json_substitute(table, value, length, output->data + output->length);
+        } else {
+            apply_table(table, value, length, output->data + output->length);
+        }
+        output->length += length;
+        return 0;
+    }
+
+    if (!options->decipher) {
+        if (line_grow(scratch, scratch_capacity, base64_encoded_size(length) + 1) != 0 ||
+            line_reserve(output, base64_encoded_size(length) + 2) != 0) {
+            return -1;
+        }
+        size_t encoded_length = base64_encode_into(value, length, (char *)*scratch);
+        if (json) {
+            output->data[output->length++] = '"';
+        }
+        apply_table(table, *scratch, encoded_length, output->data + output->length);
+        output->length += encoded_length;
+        if (json) {
+            output->data[output->length++] = '"';
+        }
+        return 0;
+    }
+
+    // Enciphered values are Base64 text, in a JSON string or a plain CSV field
+    if (length >= 2 && value[0] == '"' && value[length - 1] == '"') {
+        value++;
+        length -= 2;
+    } else if (json) {
+        return -1;
+    }
+    if (line_grow(scratch, scratch_capacity, length + 1) != 0 || line_reserve(output, length) != 0) {
+        return -1;
+    }
+    apply_table(table, value, length, *scratch);
+    output->length += base64_decode_into((char *)*scratch, length, output->data + output->length);
+    return 0;
+}
+
+// Function to find the end of the JSON string starting at pos, returning the offset past its closing quote or 0.
+static size_t json_string_end(const unsigned char *record, size_t pos, size_t len) {
+    for (pos++; pos < len; pos++) {
+        if (record[pos] == '\\') {
+            pos++;
+        } else if (record[pos] == '"') {
+            return pos + 1;
+        }
+    }
+    return 0;
+}
+
+// Function to find the end of the JSON value starting at pos, returning 0 if it is malformed.
+static size_t json_value_end(const unsigned char *record, size_t pos, size_t len) {
+    if (pos >= len) {
+        return 0;
+    }
+    if (record[pos] == '"') {
+        return json_string_end(record, pos, len);
+    }
+    if (record[pos] == '{' || record[pos] == '[') {
+        int depth = 0;
+        while (pos < len) {
+            unsigned char ch = record[pos];
+            if (ch == '"') {
+                if ((pos = json_string_end(record, pos, len)) == 0) {
+                    return 0;
+                }
+                continue;
+            }
+            if (ch == '{' || ch == '[') {
+                depth++;
+            } else if ((ch == '}' || ch == ']') && --depth == 0) {
+                return pos + 1;
+            }
+            pos++;
+        }
+        return 0;
+    }
+    size_t start = pos;
+    while (pos < len && !strchr(",}] \t\r\n", record[pos])) {
+        pos++;
+    }
+    return pos > start ? pos : 0;
+}
+
+// Function to skip JSON whitespace.
+static size_t json_skip_space(const unsigned char *record, size_t pos, size_t len) {
+    while (pos < len && (record[pos] == ' ' || record[pos] == '\t' || record[pos] == '\r' || record[pos] == '\n')) {
+        pos++;
+    }
+    return pos;
+}
+
+// Function to cipher the selected top-level keys of a JSON-lines record. Returns -1 if the record is malformed.
+static int fields_jsonl(const struct gaius_options *options, const unsigned char *table, struct line_output *output,
+                        const unsigned char *record, size_t len, unsigned char **scratch, size_t *scratch_capacity) {
+    const struct field_selection *fields = options->fields;
+    size_t pos = json_skip_space(record, 0, len), copied = 0;
+
+    // Blank lines are kept
+    if (pos == len) {
+        return line_append(output, record, len);
+    }
+    if (record[pos++] != '{') {
+        return -1;
+    }
+    while (1) {
+        pos = json_skip_space(record, pos, len);
+        if (pos < len && record[pos] == '}') {
+            break;
+        }
+        size_t key_start = pos + 1, key_end = pos < len && record[pos] == '"' ? json_string_end(record, pos, len) : 0;
+        if (key_end == 0) {
+            return -1;
+        }
+        pos = json_skip_space(record, key_end, len);
+        if (pos >= len || record[pos] != ':') {
+            return -1;
+        }
+        size_t value_start = json_skip_space(record, pos + 1, len);
+        size_t value_end = json_value_end(record, value_start, len);
+        if (value_end == 0) {
+            return -1;
+        }
+
+        size_t key_length = key_end - 1 - key_start;
+        for (int i = 0; i < fields->count; i++) {
+            if (strlen(fields->names[i]) == key_length && memcmp(fields->names[i], record + key_start, key_length) == 0) {
+                if (line_append(output, record + copied, value_start - copied) != 0 ||
+                    field_cipher(options, table, output, record + value_start, value_end - value_start, scratch, scratch_capacity) != 0) {
+                    return -1;
+                }
+                copied = value_end;
+                break;
+            }
+        }
+
+        pos = json_skip_space(record, value_end, len);
+        if (pos < len && record[pos] == ',') {
+            pos++;
+        } else if (pos >= len || record[pos] != '}') {
+            return -1;
+        }
+    }
+    return line_append(output, record + copied, len - copied);
+}
+
+// Function to find the end of the CSV field starting at pos, honoring quotes.
+static size_t csv_field_end(const unsigned char *record, size_t pos, size_t len) {
+    if (pos < len && record[pos] == '"') {
+        for (pos++; pos < len; pos++) {
+            if (record[pos] == '"') {
+                if (pos + 1 < len && record[pos + 1] == '"') {
+                    pos++;
+                } else {
+                    pos++;
+                    break;
+                }
+            }
+        }
+    }
+    while (pos < len && record[pos] != ',') {
+        pos++;
+    }
+    return pos;
+}
+
+// Function to resolve column names from a CSV header record.
+static int fields_csv_header(struct field_selection *fields, const unsigned char *record, size_t len) {
+    long column = 0;
+    for (size_t pos = 0;; column++) {
+        size_t end = csv_field_end(record, pos, len);
+        const unsigned char *name = record + pos;
+        size_t name_length = end - pos;
+        if (name_length >= 2 && name[0] == '"' && name[name_length - 1] == '"') {
+            name++;
+            name_length -= 2;
+        }
+        for (int i = 0; i < fields->count; i++) {
+            if (fields->columns[i] < 0 && strlen(fields->names[i]) == name_length && memcmp(fields->names[i], name, name_length) == 0) {
+                fields->columns[i] = column;
+            }
+        }
+        if (end >= len) {
+            break;
+        }
+        pos = end + 1;
+    }
+    for (int i = 0; i < fields->count; i++) {
+        if (fields->columns[i] < 0) {
+            fprintf(stderr, "Error: Column '%s' not found in CSV header.\n", fields->names[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Function to cipher the selected columns of a CSV record.
+static int fields_csv(const struct gaius_options *options, const unsigned char *table, struct line_output *output,
+                      const unsigned char *record, size_t len, unsigned char **scratch, size_t *scratch_capacity) {
+    const struct field_selection *fields = options->fields;
+    size_t copied = 0, record_length = len;
+
+    // A carriage return ending the record belongs to the line ending, not the last field
+    if (len > 0 && record[len - 1] == '\r') {
+        len--;
+    }
+    long column = 0;
+    for (size_t pos = 0;; column++) {
+        size_t end = csv_field_end(record, pos, len);
+        for (int i = 0; i < fields->count; i++) {
+            if (fields->columns[i] == column) {
+                if (line_append(output, record + copied, pos - copied) != 0 ||
+                    field_cipher(options, table, output, record + pos, end - pos, scratch, scratch_capacity) != 0) {
+                    return -1;
+                }
+                copied = end;
+                break;
+            }
+        }
+        if (end >= len) {
+            break;
+        }
+        pos = end + 1;
+    }
+    return line_append(output, record + copied, record_length - copied);
+}
+
+// Function to find the newline ending a record. CSV fields may hold newlines inside quotes, so the quote state
+// is carried across reads in in_quotes, along with how far the record has been scanned.
+static unsigned char *find_record_end(const struct gaius_options *options, unsigned char *record, size_t len, size_t *scanned, int *in_quotes) {
+    if (!options->fields || options->fields->format != FIELDS_CSV) {
+        unsigned char *newline = memchr(record + *scanned, '\n', len - *scanned);
+        *scanned = newline ? 0 : len;
+        return newline;
+    }
+    for (size_t pos = *scanned; pos < len; pos++) {
+        if (record[pos] == '"') {
+            *in_quotes = !*in_quotes;
+        } else if (record[pos] == '\n' && !*in_quotes) {
+            *scanned = 0;
+            return record + pos;
+        }
+    }
+    *scanned = len;
+    return NULL;
+}
+
+// Function to parse a comma separated list of CSV columns (1-based numbers or header names) or JSON keys.
+struct field_selection *parse_fields(int format, const char *list) {
+    struct field_selection *fields = calloc(1, sizeof(*fields));
+    char *copy = strdup(list);
+    int count = 1;
+
+    for (const char *ch = list; *ch; ch++) {
+        count += *ch == ',';
+    }
+    if (fields) {
+        fields->names = calloc(count, sizeof(char *));
+        fields->columns = calloc(count, sizeof(long));
+    }
+    if (!fields || !copy || !fields->names || !fields->columns) {
+        perror("Memory allocation failed for field selection");
+        return NULL;
+    }
+    fields->format = format;
+
+    for (char *name = strtok(copy, ","); name; name = strtok(NULL, ",")) {
+        char *end;
+        long column = strtol(name, &end, 10);
+        fields->names[fields->count] = name;
+        if (format == FIELDS_CSV && *end == '\0' && end != name) {
+            if (column < 1) {
+                fprintf(stderr, "Error: CSV columns are numbered from 1.\n");
+                return NULL;
+            }
+            fields->columns[fields->count] = column - 1;
+        } else {
+            // A column given by name is looked up in the header
+            fields->columns[fields->count] = -1;
+            fields->header = format == FIELDS_CSV;
+        }
+        fields->count++;
+    }
+    if (fields->count == 0) {
+        fprintf(stderr, "Error: No fields selected.\n");
+        return NULL;
+    }
+    return fields;
+}
+
+// Function to cipher one record into every target's pending output.
+static int line_record(const struct gaius_options *options, struct line_output *outputs, int target_count, size_t record,
+                       const unsigned char *line, size_t length, int newline, unsigned char **scratch, size_t *scratch_capacity) {
+    const struct gaius_target *targets = options->targets;
+
+    if (options->fields) {
+        struct field_selection *fields = options->fields;
+        for (int t = 0; t < target_count; t++) {
+            int status;
+            if (fields->header && record == 1) {
+                status = (t > 0 || fields_csv_header(fields, line, length) == 0) ? line_append(&outputs[t], line, length) : -1;
+                if (status != 0) {
+                    return -1;
+                }
+            } else {
+                status = fields->format == FIELDS_CSV ? fields_csv(options, targets[t].table, &outputs[t], line, length, scratch, scratch_capacity)
+                                                      : fields_jsonl(options, targets[t].table, &outputs[t], line, length, scratch, scratch_capacity);
+                if (status != 0) {
+                    fprintf(stderr, "Error: Malformed %s record %zu.\n", fields->format == FIELDS_CSV ? "CSV" : "JSON", record);
+                    return -1;
+                }
+            }
+            if (newline && line_append(&outputs[t], (const unsigned char *)"\n", 1) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    if (!options->decipher) {
+        // Encode the record once, then substitute it through each target's table
+        const unsigned char *source = line;
+        if (!options->disable_base64) {
+            if (line_grow(scratch, scratch_capacity, base64_encoded_size(length) + 1) != 0) {
+                return -1;
+            }
+            length = base64_encode_into(line, length, (char *)*scratch);
+            source = *scratch;
+        }
+        for (int t = 0; t < target_count; t++) {
+            if (line_reserve(&outputs[t], length + 1) != 0) {
+                return -1;
+            }
+            apply_table(targets[t].table, source, length, outputs[t].data + outputs[t].length);
+            outputs[t].length += length;
+            if (newline) {
+                outputs[t].data[outputs[t].length++] = '\n';
+            }
+        }
+        return 0;
+    }
+
+    if (line_reserve(&outputs[0], length + 1) != 0) {
+        return -1;
+    }
+    unsigned char *out = outputs[0].data + outputs[0].length;
+    if (!options->disable_base64) {
+        // Decipher the record, then decode Base64 straight into the pending output
+        if (line_grow(scratch, scratch_capacity, length + 1) != 0) {
+            return -1;
+        }
+        apply_table(targets[0].table, line, length, *scratch);
+        length = base64_decode_into((char *)*scratch, length, out);
+    } else {
+        apply_table(targets[0].table, line, length, out);
+    }
+    outputs[0].length += length;
+    if (newline) {
+        outputs[0].data[outputs[0].length++] = '\n';
+    }
+    return 0;
+}
+
+// Function to process a stream record by record. "-" reads standard input or writes standard output,
+// and when following, the end of the input file is waited on instead of ending the run.
+int process_lines(const struct gaius_options *options, const char *input_file, const char *const *output_files) {
+    int target_count = options->decipher ? 1 : options->target_count;
+    size_t capacity = options->buffer_size, start = 0, end = 0, scanned = 0, scratch_capacity = 0, records = 0;
+    unsigned char *buffer = malloc(capacity), *scratch = NULL;
+    struct line_output outputs[target_count];
+    int input_fd = strcmp(input_file, "-") == 0 ? STDIN_FILENO : open(input_file, O_RDONLY);
+    int watch_fd = -1, status = 0, in_quotes = 0;
+    long long window_start = 0;
+
+    if (input_fd < 0) {
+        perror("Error opening input file");
+        free(buffer);
+        return -1;
+    }
+    memset(outputs, 0, sizeof(outputs));
+    for (int t = 0; t < target_count; t++) {
+        outputs[t].fd = strcmp(output_files[t], "-") == 0 ? STDOUT_FILENO : open(output_files[t], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        outputs[t].capacity = options->decipher || options->disable_base64 ? options->buffer_size + 1 : base64_encoded_size(options->buffer_size) + 1;
+        outputs[t].data = malloc(outputs[t].capacity);
+        if (outputs[t].fd < 0) {
+            perror("Error opening output file");
+            status = -1;
+        } else if (!outputs[t].data) {
+            perror("Memory allocation failed for buffers");
+            status = -1;
+        }
+    }
+    if (!buffer) {
+        perror("Memory allocation failed for buffers");
+        status = -1;
+    }
+#ifdef __linux__
+    if (options->follow && input_fd != STDIN_FILENO) {
+        watch_fd = inotify_init1(IN_CLOEXEC);
+        if (watch_fd >= 0 && inotify_add_watch(watch_fd, input_file, IN_MODIFY) < 0) {
+            close(watch_fd);
+            watch_fd = -1;
+        }
+    }
+#endif
+
+    while (status == 0) {
+        // Keep the unfinished record at the front, and grow the buffer for records longer than it
+        if (end == capacity) {
+            if (start > 0) {
+                memmove(buffer, buffer + start, end - start);
+                end -= start;
+                start = 0;
+            } else if (line_grow(&buffer, &capacity, capacity * 2) != 0) {
+                status = -1;
+                break;
+            }
+        }
+
+        size_t wanted = capacity - end;
+        ssize_t n = read(input_fd, buffer + end, wanted);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error reading input file");
+            status = -1;
+            break;
+        }
+        if (n == 0) {
+            if (!options->follow || input_fd == STDIN_FILENO) {
+                break;
+            }
+            // Caught up with the writer, so nothing pending may wait for the next record
+            for (int t = 0; t < target_count && status == 0; t++) {
+                status = line_flush(&outputs[t]);
+            }
+            wait_for_growth(watch_fd);
+            continue;
+        }
+        end += n;
+
+        unsigned char *newline;
+        while ((newline = find_record_end(options, buffer + start, end - start, &scanned, &in_quotes)) != NULL) {
+            size_t length = newline - (buffer + start);
+            if (window_start == 0) {
+                window_start = monotonic_ns();
+            }
+            records++;
+            if (line_record(options, outputs, target_count, records, buffer + start, length, 1, &scratch, &scratch_capacity) != 0) {
+                status = -1;
+                break;
+            }
+            start += length + 1;
+        }
+
+        // A short read means the reader has caught up, otherwise keep batching up to the flush window
+        if (window_start && ((size_t)n < wanted || monotonic_ns() - window_start >= GAIUS_LINE_FLUSH_WINDOW_NS)) {
+            for (int t = 0; t < target_count && status == 0; t++) {
+                status = line_flush(&outputs[t]);
+            }
+            window_start = 0;
+        }
+    }
+
+    // A last record without a newline is kept that way
+    if (status == 0 && start < end) {
+        records++;
+        status = line_record(options, outputs, target_count, records, buffer + start, end - start, 0, &scratch, &scratch_capacity);
+    }
+    for (int t = 0; t < target_count; t++) {
+        if (status == 0 && outputs[t].fd >= 0) {
+            status = line_flush(&outputs[t]);
+        }
+        if (outputs[t].fd > STDOUT_FILENO && close(outputs[t].fd) != 0 && status == 0) {
+            perror("Error writing output file");
+            status = -1;
+        }
+        free(outputs[t].data);
+    }
+
+    // Standard output may be carrying the records, so the summary goes to standard error
+    if (options->enable_verbosity) {
+        fprintf(stderr, "Processed %zu records from: %s\n", records, input_file);
+    }
+
+    if (watch_fd >= 0) {
+        close(watch_fd);
+    }
+    if (input_fd != STDIN_FILENO) {
+        close(input_fd);
+    }
+    free(buffer);
+    free(scratch);
+    return status;
+}
+
+// Duplicate detection for directory mode. Every processed file is remembered by (device, inode) and by
+// size, so later hardlinks to it are linked in the output and later copies of its content are cloned
+// from its output instead of being ciphered again. Output depends only on content and settings, so a
+// clone is identical to what ciphering the copy would produce.
+
+#define DEDUP_BUCKETS 4096
+
+struct dedup_entry {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    uint32_t hash;
+    int hash_valid;
+    char *input_path;
+    char **output_paths; // One per target.
+    struct dedup_entry *next_by_inode;
+    struct dedup_entry *next_by_size;
+};
+
+struct dedup_index {
+    struct dedup_entry *by_inode[DEDUP_BUCKETS];
+    struct dedup_entry *by_size[DEDUP_BUCKETS];
+    size_t linked, cloned;
+};
+
+// Function to hash a whole file with CRC32C, used to group files of equal size before comparing them.
+static int dedup_hash_file(const char *path, uint32_t *hash) {
+    unsigned char buffer[65536];
+    uint32_t crc = 0;
+    size_t n;
+    FILE *fp = fopen(path, "rb");
+
+    if (!fp) {
+        return -1;
+    }
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        crc = crc32c(crc, buffer, n);
+    }
+    int failed = ferror(fp);
+    fclose(fp);
+    *hash = crc;
+    return failed ? -1 : 0;
+}
+
+// Function to check two files byte for byte, a matching CRC alone is not proof of equal content.
+static int dedup_same_content(const char *path_a, const char *path_b) {
+    unsigned char buffer_a[65536], buffer_b[65536];
+    FILE *fp_a = fopen(path_a, "rb");
+    FILE *fp_b = fopen(path_b, "rb");
+    int same = fp_a && fp_b;
+
+    while (same) {
+        size_t n_a = fread(buffer_a, 1, sizeof(buffer_a), fp_a);
+        size_t n_b = fread(buffer_b, 1, sizeof(buffer_b), fp_b);
+        if (n_a != n_b || memcmp(buffer_a, buffer_b, n_a) != 0) {
+            same = 0;
+        } else if (n_a == 0) {
+            break;
+        }
+    }
+    if (fp_a) fclose(fp_a);
+    if (fp_b) fclose(fp_b);
+    return same;
+}
+
+// Function to make destination a copy of source, sharing extents with FICLONE where the filesystem allows.
+static int clone_file(const char *source, const char *destination) {
+    int in_fd = open(source, O_RDONLY);
+    if (in_fd < 0) {
+        return -1;
+    }
+    int out_fd = open(destination, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) {
+        close(in_fd);
+        return -1;
+    }
+
+    int status = -1;
+#ifdef FICLONE
+    if (ioctl(out_fd, FICLONE, in_fd) == 0) {
+        status = 0;
+    }
+#endif
+    if (status != 0) {
+        // Plain copy, in-kernel where possible
+        char buffer[65536];
+        ssize_t n = 0;
+        status = 0;
+#ifdef __linux__
+        while ((n = copy_file_range(in_fd, NULL, out_fd, NULL, 1 << 30, 0)) > 0) {
+        }
+#else
+        n = -1;
+#endif
+        if (n < 0) {
+            lseek(in_fd, 0, SEEK_SET);
+            lseek(out_fd, 0, SEEK_SET);
+            if (ftruncate(out_fd, 0) != 0) {
+                status = -1;
+            }
+            while (status == 0 && (n = read(in_fd, buffer, sizeof(buffer))) > 0) {
+                if (write(out_fd, buffer, n) != n) {
+                    status = -1;
+                }
+            }
+            if (n < 0) {
+                status = -1;
+            }
+        }
+    }
+
+    close(in_fd);
+    if (close(out_fd) != 0) {
+        status = -1;
+    }
+    return status;
+}
+
+// Function to find an already processed file with the same inode or content as input_path.
+static struct dedup_entry *dedup_find(struct dedup_index *index, const char *input_path, const struct stat *input_stat, int *is_link) {
+    struct dedup_entry *entry;
+
+    *is_link = 0;
+    if (input_stat->st_nlink > 1) {
+        for (entry = index->by_inode[input_stat->st_ino % DEDUP_BUCKETS]; entry; entry = entry->next_by_inode) {
+            if (entry->dev == input_stat->st_dev && entry->ino == input_stat->st_ino) {
+                *is_link = 1;
+                return entry;
+            }
+        }
+    }
+
+    // Empty files are cheaper to process than to compare
+    if (input_stat->st_size == 0) {
+        return NULL;
+    }
+
+    // Only hash when another file of the same size exists
+    uint32_t hash = 0;
+    int hashed = 0;
+    for (entry = index->by_size[input_stat->st_size % DEDUP_BUCKETS]; entry; entry = entry->next_by_size) {
+        if (entry->size != input_stat->st_size) {
+            continue;
+        }
+        if (!hashed) {
+            if (dedup_hash_file(input_path, &hash) != 0) {
+                return NULL;
+            }
+            hashed = 1;
+        }
+        if (!entry->hash_valid) {
+            if (dedup_hash_file(entry->input_path, &entry->hash) != 0) {
+                continue;
+            }
+            entry->hash_valid = 1;
+        }
+        if (entry->hash == hash && dedup_same_content(entry->input_path, input_path)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Function to remember a processed file, by content only if index_content is set.
+static void dedup_add(struct dedup_index *index, const char *input_path, const struct stat *input_stat,
+                      const char *const *output_paths, int target_count, int index_content) {
+    struct dedup_entry *entry = calloc(1, sizeof(*entry));
+    if (!entry) {
+        return; // Deduplication is an optimization, running without it is fine
+    }
+    entry->dev = input_stat->st_dev;
+    entry->ino = input_stat->st_ino;
+    entry->size = input_stat->st_size;
+    entry->input_path = strdup(input_path);
+    entry->output_paths = calloc(target_count, sizeof(char *));
+    if (!entry->input_path || !entry->output_paths) {
+        free(entry->input_path);
+        free(entry->output_paths);
+        free(entry);
+        return;
+    }
+    for (int t = 0; t < target_count; t++) {
+        entry->output_paths[t] = strdup(output_paths[t]);
+    }
+
+    entry->next_by_inode = index->by_inode[entry->ino % DEDUP_BUCKETS];
+    index->by_inode[entry->ino % DEDUP_BUCKETS] = entry;
+    if (index_content) {
+        entry->next_by_size = index->by_size[entry->size % DEDUP_BUCKETS];
+        index->by_size[entry->size % DEDUP_BUCKETS] = entry;
+    }
+}
+
+// Function to release a duplicate index and everything it remembers.
+static void dedup_free(struct dedup_index *index, int target_count) {
+    for (int b = 0; b < DEDUP_BUCKETS; b++) {
+        struct dedup_entry *entry = index->by_inode[b];
+        while (entry) {
+            struct dedup_entry *next = entry->next_by_inode;
+            for (int t = 0; t < target_count; t++) {
+                free(entry->output_paths[t]);
+            }
+            free(entry->output_paths);
+            free(entry->input_path);
+            free(entry);
+            entry = next;
+        }
+    }
+    free(index);
+}
+
+// Function to process a file in directory mode with deduplication enabled.
+static int dedup_process_file(const struct gaius_options *options, const char *input_path, const char *const *output_paths) {
+    struct dedup_index *index = options->dedup;
+    int target_count = options->decipher ? 1 : options->target_count;
+    struct stat input_stat;
+    int is_link;
+
+    if (stat(input_path, &input_stat) != 0 || !S_ISREG(input_stat.st_mode)) {
+        return process_file(options, input_path, output_paths);
+    }
+
+    struct dedup_entry *entry = dedup_find(index, input_path, &input_stat, &is_link);
+    if (entry) {
+        // Reused outputs are linked or cloned under the temporary name and committed like ciphered ones
+        char temp_files[target_count][1024];
+        int materialized = 1, made = 0;
+        for (; made < target_count && materialized; made++) {
+            if (!entry->output_paths[made] || output_temp_path(output_paths[made], temp_files[made], sizeof(temp_files[made])) != 0 ||
+                strcmp(temp_files[made], output_paths[made]) == 0) {
+                materialized = 0;
+                break;
+            }
+            // Hardlinks stay hardlinks, copies become reflinks or plain copies
+            unlink(temp_files[made]);
+            if (is_link && link(entry->output_paths[made], temp_files[made]) == 0) {
+                continue;
+            }
+            if (clone_file(entry->output_paths[made], temp_files[made]) != 0) {
+                unlink(temp_files[made]);
+                materialized = 0;
+                break;
+            }
+        }
+        if (!materialized) {
+            while (made-- > 0) {
+                unlink(temp_files[made]);
+            }
+        } else if (commit_outputs(options, input_path, temp_files, output_paths, target_count, 0) == 0) {
+            if (is_link) {
+                index->linked++;
+            } else {
+                index->cloned++;
+            }
+            if (options->enable_verbosity) {
+                printf("%s of %s, reusing output: %s\n", is_link ? "Hardlink" : "Duplicate", entry->input_path, output_paths[0]);
+            }
+            // A cloned copy can still have hardlinks of its own later in the tree
+            if (!is_link && input_stat.st_nlink > 1) {
+                dedup_add(index, input_path, &input_stat, output_paths, target_count, 0);
+            }
+            return 0;
+        }
+    }
+
+    int status = process_file(options, input_path, output_paths);
+    if (status == 0 && !entry) {
+        dedup_add(index, input_path, &input_stat, output_paths, target_count, 1);
+    }
+    return status;
+}
+
+// Sharding for directory mode. "-shard i/N" makes a run handle only the files assigned to shard i of N, so N
+// runs over one tree, on any number of machines sharing the filesystem, together cover every file exactly once
+// without talking to each other. A file's shard is the CRC32C of its path relative to the input directory,
+// which every run computes alike. With "-shard-balance" every run instead lists the whole tree and deals the
+// files out largest first to the least loaded shard, ties broken by path, so all runs arrive at the same plan
+// and the shards end up close in total size. That plan only holds while the tree does not change between the
+// runs listing it. Every shard creates every output directory, which create_directory() tolerates.
+#define SHARD_MAX 1024
+
+struct gaius_shard {
+    int index;          // This run's shard, counted from 0.
+    int count;
+    size_t root_length; // Length of the input directory, stripped from paths before they are hashed or looked up.
+    char **paths;       // With balancing, the sorted relative paths of this run's files, NULL otherwise.
+    size_t path_count;
+};
+
+struct shard_file {
+    char *path; // Relative to the input directory.
+    off_t size;
+};
+
+struct shard_list {
+    struct shard_file *files;
+    size_t count, capacity;
+};
+
+// Function to parse a "-shard" value of the form i/N, i counted from 1. Returns 0 on success.
+int parse_shard(const char *text, int *index, int *count) {
+    char *end;
+
+    if (!isdigit((unsigned char)text[0])) {
+        return -1;
+    }
+    errno = 0;
+    long i = strtol(text, &end, 10);
+    if (*end != '/' || !isdigit((unsigned char)end[1])) {
+        return -1;
+    }
+    long n = strtol(end + 1, &end, 10);
+    if (*end != '\0' || errno != 0 || n < 1 || n > SHARD_MAX || i < 1 || i > n) {
+        return -1;
+    }
+    *index = (int)i - 1;
+    *count = (int)n;
+    return 0;
+}
+
+// Function to get the part of a path below the input directory, whatever slashes joined them.
+static const char *shard_relative(const char *path, size_t root_length) {
+    path += root_length;
+    while (*path == '/') {
+        path++;
+    }
+    return path;
+}
+
+// Function to order files largest first, then by path, so every run deals them out in the same order.
+static int compare_shard_files(const void *a, const void *b) {
+    const struct shard_file *fa = a, *fb = b;
+    if (fa->size != fb->size) {
+        return fa->size > fb->size ? -1 : 1;
+    }
+    return strcmp(fa->path, fb->path);
+}
+
+// Function to order relative paths for bsearch().
+static int compare_shard_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Recursive function to list every file below a directory with its size, walking it as process_directory() does.
+static int shard_list_files(const char *dir_path, size_t root_length, struct shard_list *list) {
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        perror("Failed to open input directory");
+        return -1;
+    }
+
+    int status = 0;
+    struct dirent *entry;
+    while (status == 0 && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+        struct stat path_stat;
+        int found = stat(path, &path_stat) == 0;
+        if (found && S_ISDIR(path_stat.st_mode)) {
+            status = shard_list_files(path, root_length, list);
+            continue;
+        }
+
+        if (list->count == list->capacity) {
+            size_t capacity = list->capacity ? list->capacity * 2 : 1024;
+            struct shard_file *files = realloc(list->files, capacity * sizeof(*files));
+            if (!files) {
+                perror("Memory allocation failed for shard plan");
+                status = -1;
+                break;
+            }
+            list->files = files;
+            list->capacity = capacity;
+        }
+        list->files[list->count].path = strdup(shard_relative(path, root_length));
+        list->files[list->count].size = found ? path_stat.st_size : 0;
+        if (!list->files[list->count].path) {
+            perror("Memory allocation failed for shard plan");
+            status = -1;
+            break;
+        }
+        list->count++;
+    }
+
+    closedir(dir);
+    return status;
+}
+
+// Function to set up shard index of count for a directory, planning the balanced assignment if asked to.
+struct gaius_shard *shard_create(int index, int count, const char *input_dir, int balance) {
+    struct gaius_shard *shard = calloc(1, sizeof(*shard));
+    if (!shard) {
+        perror("Memory allocation failed for shard");
+        return NULL;
+    }
+    shard->index = index;
+    shard->count = count;
+    shard->root_length = strlen(input_dir);
+    if (!balance) {
+        return shard;
+    }
+
+    struct shard_list list = {0};
+    uint64_t *loads = calloc(count, sizeof(*loads));
+    int status = loads ? shard_list_files(input_dir, shard->root_length, &list) : -1;
+    if (status == 0) {
+        shard->paths = malloc((list.count ? list.count : 1) * sizeof(*shard->paths));
+        if (!shard->paths) {
+            perror("Memory allocation failed for shard plan");
+            status = -1;
+        }
+    }
+    if (status != 0) {
+        if (!loads) {
+            perror("Memory allocation failed for shard plan");
+        }
+        for (size_t i = 0; i < list.count; i++) {
+            free(list.files[i].path);
+        }
+        free(list.files);
+        free(loads);
+        free(shard);
+        return NULL;
+    }
+
+    // Greedy largest first assignment, empty files count as one byte so they spread out too
+    qsort(list.files, list.count, sizeof(*list.files), compare_shard_files);
+    for (size_t i = 0; i < list.count; i++) {
+        int least = 0;
+        for (int s = 1; s < count; s++) {
+            if (loads[s] < loads[least]) {
+                least = s;
+            }
+        }
+        loads[least] += (uint64_t)list.files[i].size + 1;
+        if (least == index) {
+            shard->paths[shard->path_count++] = list.files[i].path;
+        } else {
+            free(list.files[i].path);
+        }
+    }
+    qsort(shard->paths, shard->path_count, sizeof(*shard->paths), compare_shard_paths);
+
+    free(list.files);
+    free(loads);
+    return shard;
+}
+
+// Function to check whether a file below the input directory belongs to this run's shard.
+static int shard_owns(const struct gaius_shard *shard, const char *input_path) {
+    const char *relative = shard_relative(input_path, shard->root_length);
+
+    if (shard->paths) {
+        return bsearch(&relative, shard->paths, shard->path_count, sizeof(*shard->paths), compare_shard_paths) != NULL;
+    }
+    return crc32c(0, (const unsigned char *)relative, strlen(relative)) % (uint32_t)shard->count == (uint32_t)shard->index;
+}
+
+// Function to name a shard for its journal, as ".shard<i>of<N>".
+void shard_describe(const struct gaius_shard *shard, char *buffer, size_t size) {
+    snprintf(buffer, size, ".shard%dof%d", shard->index + 1, shard->count);
+}
+
+// Function to free a shard and its plan.
+static void shard_free(struct gaius_shard *shard) {
+    for (size_t i = 0; i < shard->path_count; i++) {
+        free(shard->paths[i]);
+    }
+    free(shard->paths);
+    free(shard);
+}
+
+// Preflight for directory mode. Before anything is written the tree is listed by PREFLIGHT_THREADS threads at
+// once, giving the number of files and bytes to process. From those the output size is predicted, exactly
+// where it only depends on the input size and as an upper bound otherwise, and checked against the free space
+// of each output filesystem, so a run that cannot fit fails at once instead of hours in. Files are then
+// processed largest first by "-jobs" workers, which keeps one big file from being left for last and
+// stretching the run, and progress is measured against the preflight totals.
+#define PREFLIGHT_THREADS 8
+
+struct preflight_file {
+    char *path;      // Input path, below the input directory.
+    off_t size;
+    off_t allocated; // Bytes actually stored, less than size for a sparse file.
+};
+
+struct preflight {
+    const struct gaius_options *options;
+    char **pending;   // Directories waiting to be listed.
+    size_t pending_count, pending_capacity;
+    int busy;         // Threads listing a directory.
+    char **dirs;      // Every directory below the input directory.
+    size_t dir_count, dir_capacity;
+    struct preflight_file *files;
+    size_t file_count, file_capacity;
+    uint64_t total_bytes;
+    size_t skipped;   // Files of other shards, or finished by an earlier run.
+    int failed;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+};
+
+// Function to append a pointer to a growable array. Call with the lock held.
+static int preflight_push(char ***items, size_t *count, size_t *capacity, char *item) {
+    if (*count == *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 64;
+        char **resized = realloc(*items, grown * sizeof(**items));
+        if (!resized) {
+            return -1;
+        }
+        *items = resized;
+        *capacity = grown;
+    }
+    (*items)[(*count)++] = item;
+    return 0;
+}
+
+// Function to list one directory into the preflight. Entries are classified without the lock, then added at once.
+static int preflight_list(struct preflight *scan, const char *dir_path) {
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        fprintf(stderr, "Error: Failed to open input directory %s: %s\n", dir_path, strerror(errno));
+        return -1;
+    }
+
+    int status = 0;
+    struct dirent *entry;
+    while (status == 0 && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+        struct stat path_stat;
+        int found = fstatat(dirfd(dir), entry->d_name, &path_stat, 0) == 0;
+        int is_dir = found && S_ISDIR(path_stat.st_mode);
+
+        // The same choices process_file() makes, so the totals only hold work that will be done
+        struct journal_entry *done = !is_dir && scan->options->journal ? journal_find(scan->options->journal, path, 0) : NULL;
+        int skip = !is_dir && ((scan->options->shard && !shard_owns(scan->options->shard, path)) || (done && done->complete));
+
+        if (skip && done && done->complete) {
+            if (scan->options->enable_verbosity) {
+                printf("Skipping file completed by an earlier run: %s\n", path);
+            }
+            pthread_mutex_lock(&scan->options->journal->lock);
+            scan->options->journal->skipped++;
+            pthread_mutex_unlock(&scan->options->journal->lock);
+        }
+
+        char *copy = skip ? NULL : strdup(path);
+        pthread_mutex_lock(&scan->lock);
+        if (skip) {
+            scan->skipped++;
+        } else if (!copy) {
+            status = -1;
+        } else if (is_dir) {
+            if (preflight_push(&scan->dirs, &scan->dir_count, &scan->dir_capacity, copy) != 0 ||
+                preflight_push(&scan->pending, &scan->pending_count, &scan->pending_capacity, copy) != 0) {
+                status = -1;
+            }
+            pthread_cond_signal(&scan->work);
+        } else {
+            if (scan->file_count == scan->file_capacity) {
+                size_t capacity = scan->file_capacity ? scan->file_capacity * 2 : 1024;
+                struct preflight_file *files = realloc(scan->files, capacity * sizeof(*files));
+                if (files) {
+                    scan->files = files;
+                    scan->file_capacity = capacity;
+                }
+            }
+            if (scan->file_count < scan->file_capacity) {
+                off_t size = found ? path_stat.st_size : 0;
+                off_t allocated = found ? (off_t)path_stat.st_blocks * 512 : 0;
+                scan->files[scan->file_count++] = (struct preflight_file){copy, size, allocated};
+                scan->total_bytes += size;
+            } else {
+                free(copy);
+                status = -1;
+            }
+        }
+        pthread_mutex_unlock(&scan->lock);
+        if (status != 0) {
+            perror("Memory allocation failed for preflight");
+        }
+    }
+    closedir(dir);
+    return status;
+}
+
+// Thread body: lists directories until none are pending and no thread can find more.
+static void *preflight_worker(void *arg) {
+    struct preflight *scan = arg;
+
+    pthread_mutex_lock(&scan->lock);
+    for (;;) {
+        while (!scan->pending_count && scan->busy && !scan->failed) {
+            pthread_cond_wait(&scan->work, &scan->lock);
+        }
+        if (!scan->pending_count || scan->failed) {
+            break;
+        }
+        char *dir_path = scan->pending[--scan->pending_count];
+        scan->busy++;
+        pthread_mutex_unlock(&scan->lock);
+
+        int status = preflight_list(scan, dir_path);
+
+        pthread_mutex_lock(&scan->lock);
+        scan->busy--;
+        if (status != 0) {
+            scan->failed = 1;
+        }
+        if (!scan->busy || scan->failed) {
+            pthread_cond_broadcast(&scan->work);
+        }
+    }
+    pthread_mutex_unlock(&scan->lock);
+    return NULL;
+}
+
+// Function to order files largest first, then by path, see process_directory().
+static int compare_preflight_files(const void *a, const void *b) {
+    const struct preflight_file *fa = a, *fb = b;
+    if (fa->size != fb->size) {
+        return fa->size > fb->size ? -1 : 1;
+    }
+    return strcmp(fa->path, fb->path);
+}
+
+// Function to predict the size of one output of a file. Exact when enciphering, an upper bound when deciphering
+// or with "-adaptive", whose chunks are only known once they are read.
+static uint64_t predict_output_size(const struct gaius_options *options, uint64_t size) {
+    uint64_t chunk = options->buffer_size;
+    uint64_t chunks = (size + chunk - 1) / chunk;
+
+    if (options->decipher) {
+        return options->disable_base64 ? size : size / 4 * 3 + 3;
+    }
+    uint64_t output = options->disable_base64 ? size : size / chunk * base64_encoded_size(chunk) + base64_encoded_size(size % chunk);
+    if (options->enable_crc || options->enable_adaptive) {
+        uint16_t flags = (options->enable_crc ? GAIUS_FLAG_CRC32C : 0) | (options->enable_adaptive ? GAIUS_FLAG_ADAPTIVE : 0);
+        output += GAIUS_HEADER_SIZE + chunks * frame_header_size(flags);
+    }
+    return output;
+}
+
+// Function to check that every output filesystem has room for the predicted output of the given files, with
+// each file rounded up to whole blocks. Outputs on the same filesystem add up. Outputs that are devices or pipes,
+// like /dev/null, take no space and are not checked, the same rule the journal follows in main().
+static int check_free_space(const struct gaius_options *options, const char *const *output_paths, const struct preflight_file *files, size_t count) {
+    int target_count = options->decipher ? 1 : options->target_count;
+    dev_t devices[target_count];
+    struct statvfs filesystems[target_count];
+    uint64_t needed[target_count];
+    int unchecked[target_count];
+    // Where process_file() keeps holes as holes, only the data of a sparse input takes space in its output
+    int holes_kept = options->disable_base64 && !options->enable_crc && !options->enable_adaptive && !options->direct_io;
+
+    for (int t = 0; t < target_count; t++) {
+        struct stat output_stat;
+        unchecked[t] = stat(output_paths[t], &output_stat) == 0 && !S_ISREG(output_stat.st_mode) && !S_ISDIR(output_stat.st_mode);
+        if (unchecked[t]) {
+            continue;
+        }
+        // A single file's output may not exist yet, its directory does
+        char location[1024];
+        snprintf(location, sizeof(location), "%s", output_paths[t]);
+        if (!is_directory(location)) {
+            char *slash = strrchr(location, '/');
+            if (slash == location) {
+                slash[1] = '\0';
+            } else if (slash) {
+                *slash = '\0';
+            } else {
+                strcpy(location, ".");
+            }
+        }
+        struct stat location_stat;
+        if (stat(location, &location_stat) != 0 || statvfs(location, &filesystems[t]) != 0) {
+            fprintf(stderr, "Warning: Could not check free space for %s: %s\n", output_paths[t], strerror(errno));
+            return 0;
+        }
+        devices[t] = location_stat.st_dev;
+
+        uint64_t block = filesystems[t].f_frsize ? filesystems[t].f_frsize : 4096;
+        needed[t] = 0;
+        for (size_t f = 0; f < count; f++) {
+            off_t stored = holes_kept && files[f].allocated < files[f].size ? files[f].allocated : files[f].size;
+            needed[t] += (predict_output_size(options, stored) + block - 1) / block * block;
+        }
+    }
+
+    int status = 0;
+    for (int t = 0; t < target_count; t++) {
+        uint64_t total = 0;
+        int first = 1;
+        if (unchecked[t]) {
+            continue;
+        }
+        for (int u = 0; u < target_count; u++) {
+            if (!unchecked[u] && devices[u] == devices[t]) {
+                total += needed[u];
+                first = first && u >= t;
+            }
+        }
+        if (!first) {
+            continue; // Reported with the first output on the same filesystem.
+        }
+        uint64_t available = (uint64_t)filesystems[t].f_bavail * filesystems[t].f_frsize;
+        char needed_text[32], available_text[32];
+        format_size(total, needed_text, sizeof(needed_text));
+        format_size(available, available_text, sizeof(available_text));
+        if (options->enable_verbosity) {
+            printf("Output space for %s: %s needed, %s available.\n", output_paths[t], needed_text, available_text);
+        }
+        if (total > available) {
+            fprintf(stderr, "Error: Not enough free space for %s: %s needed, %s available. Use '-no-space-check' to run anyway.\n",
+                    output_paths[t], needed_text, available_text);
+            status = -1;
+        }
+    }
+    return status;
+}
+
+// Shared state of the workers of a directory run, each takes the next file of the largest-first list.
+struct directory_job {
+    const struct gaius_options *options;
+    const char *const *output_dirs;
+    int target_count;
+    size_t root_length;
+    struct preflight_file *files;
+    size_t file_count, next_file;
+    int status;
+    pthread_mutex_t lock;
+};
+
+// Thread body: processes files until none are left.
+static void *directory_worker(void *arg) {
+    struct directory_job *job = arg;
+    const struct gaius_options *options = job->options;
+    char (*output_paths)[1024] = malloc(job->target_count * sizeof(*output_paths));
+    const char **output_path_list = malloc(job->target_count * sizeof(*output_path_list));
+    if (!output_paths || !output_path_list) {
+        perror("Memory allocation failed for output paths");
+        exit(1);
+    }
+    for (int t = 0; t < job->target_count; t++) {
+        output_path_list[t] = output_paths[t];
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        size_t index = job->next_file++;
+        pthread_mutex_unlock(&job->lock);
+        if (index >= job->file_count) {
+            break;
+        }
+
+        const char *input_path = job->files[index].path;
+        for (int t = 0; t < job->target_count; t++) {
+            snprintf(output_paths[t], sizeof(output_paths[t]), "%s/%s", job->output_dirs[t], shard_relative(input_path, job->root_length));
+        }
+        if (options->enable_verbosity) {
+            printf("Found file: %s\n", input_path);
+        }
+        int status = options->dedup ? dedup_process_file(options, input_path, output_path_list)
+                                    : process_file(options, input_path, output_path_list);
+        if (options->progress) {
+            __atomic_fetch_add(&options->progress->done_files, 1, __ATOMIC_RELAXED);
+        }
+        if (status != 0) {
+            pthread_mutex_lock(&job->lock);
+            job->status = -1;
+            pthread_mutex_unlock(&job->lock);
+        }
+    }
+
+    free(output_paths);
+    free(output_path_list);
+    return NULL;
+}
+
+// Function to process a directory, mirroring it into every target's output directory: preflight, space check,
+// then the files largest first.
+int process_directory(const struct gaius_options *options, const char *input_dir, const char *const *output_dirs) {
+    int target_count = options->decipher ? 1 : options->target_count;
+    struct preflight scan = {0};
+    int status = 0;
+
+    if (options->enable_verbosity) {
+        printf("Processing directory: %s\n", input_dir);
+        for (int t = 0; t < target_count; t++) {
+            printf("Output directory: %s\n", output_dirs[t]);
+        }
+    }
+
+    scan.options = options;
+    pthread_mutex_init(&scan.lock, NULL);
+    pthread_cond_init(&scan.work, NULL);
+    char *root = strdup(input_dir);
+    if (!root || preflight_push(&scan.pending, &scan.pending_count, &scan.pending_capacity, root) != 0) {
+        perror("Memory allocation failed for preflight");
+        exit(1);
+    }
+    pthread_t threads[PREFLIGHT_THREADS];
+    int started = 0;
+    for (; started < PREFLIGHT_THREADS; started++) {
+        if (pthread_create(&threads[started], NULL, preflight_worker, &scan) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        preflight_worker(&scan); // Fall back to listing on this thread
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    status = scan.failed ? -1 : 0;
+
+    if (status == 0 && options->enable_verbosity) {
+        char total_text[32];
+        format_size(scan.total_bytes, total_text, sizeof(total_text));
+        printf("Preflight: %zu files (%s) in %zu directories to process, %zu skipped.\n", scan.file_count, total_text, scan.dir_count, scan.skipped);
+    }
+    if (status == 0 && options->space_check && check_free_space(options, output_dirs, scan.files, scan.file_count) != 0) {
+        status = -1;
+    }
+
+    // Parents sort before their children, so every directory exists before anything is written into it
+    size_t root_length = strlen(input_dir);
+    if (status == 0) {
+        qsort(scan.dirs, scan.dir_count, sizeof(*scan.dirs), compare_shard_paths);
+        for (size_t d = 0; d < scan.dir_count; d++) {
+            for (int t = 0; t < target_count; t++) {
+                char output_path[1024];
+                snprintf(output_path, sizeof(output_path), "%s/%s", output_dirs[t], shard_relative(scan.dirs[d], root_length));
+                if (options->enable_verbosity) {
+                    printf("Creating output directory: %s\n", output_path);
+                }
+                create_directory(output_path);
+            }
+        }
+    }
+
+    if (status == 0) {
+        struct directory_job job = {options, output_dirs, target_count, root_length, scan.files, scan.file_count, 0, 0, PTHREAD_MUTEX_INITIALIZER};
+        qsort(scan.files, scan.file_count, sizeof(*scan.files), compare_preflight_files);
+        if (options->progress) {
+            progress_start(options->progress, scan.total_bytes, scan.file_count);
+        }
+
+        int worker_count = options->jobs > 1 && (size_t)options->jobs > scan.file_count ? (int)scan.file_count : options->jobs;
+        pthread_t workers[worker_count > 1 ? worker_count : 1];
+        int running = 0;
+        for (; worker_count > 1 && running < worker_count; running++) {
+            if (pthread_create(&workers[running], NULL, directory_worker, &job) != 0) {
+                break;
+            }
+        }
+        if (running == 0) {
+            directory_worker(&job); // A single job runs on this thread
+        }
+        for (int t = 0; t < running; t++) {
+            pthread_join(workers[t], NULL);
+        }
+        status = job.status;
+
+        if (options->progress) {
+            progress_finish(options->progress);
+        }
+        pthread_mutex_destroy(&job.lock);
+    }
+
+    if (options->enable_verbosity) {
+        printf("Finished processing directory: %s\n", input_dir);
+    }
+
+    for (size_t f = 0; f < scan.file_count; f++) {
+        free(scan.files[f].path);
+    }
+    for (size_t d = 0; d < scan.dir_count; d++) {
+        free(scan.dirs[d]);
+    }
+    free(root);
+    free(scan.files);
+    free(scan.dirs);
+    free(scan.pending);
+    pthread_cond_destroy(&scan.work);
+    pthread_mutex_destroy(&scan.lock);
+    return status;
+}
+
+// Watch mode. "-watch" ciphers a directory like a normal run, then keeps running and ciphers every file that
+// appears in the tree as soon as it is complete: closed after writing (IN_CLOSE_WRITE) or moved in (IN_MOVED_TO).
+// New subdirectories are mirrored into the outputs, watched, and scanned for files that arrived before their
+// watch did. The reading thread only queues paths; a pool of "-jobs" workers runs process_file() on them with
+// the run's settings. A file written again while queued is ciphered once, and one written again while being
+// ciphered is queued again. Nothing polls: the thread sleeps in poll() on the inotify descriptor and a
+// signalfd, and SIGINT or SIGTERM stop it once the running files are done. The journal is kept then, so a
+// restart with "-resume" skips what is already done, files still queued included in the restart's scan.
+#ifdef __linux__
+#define WATCH_BUCKETS 4096
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR)
+
+struct watch_item {
+    char *path;               // Input file below the watched directory.
+    int running;              // A worker is ciphering it.
+    int queued;               // Waiting for a worker, possibly again after the running pass.
+    struct watch_item *next_queued;
+    struct watch_item *next;  // Next item in the same bucket.
+};
+
+struct watch_state {
+    const struct gaius_options *options;
+    size_t root_length;       // Length of the input directory, stripped to get output paths.
+    const char *const *output_dirs;
+    int target_count;
+    int inotify_fd;
+    char **watched;           // Directory of each watch descriptor, indexed by descriptor.
+    int watched_capacity;
+    pthread_mutex_t lock;     // Guards everything below.
+    pthread_cond_t ready;
+    struct watch_item *head, *tail;
+    struct watch_item *buckets[WATCH_BUCKETS];
+    int stopping;
+    int status;
+};
+
+// Function to find the item of a path, unlinking it from its bucket if asked to. Call with the lock held.
+static struct watch_item *watch_find(struct watch_state *state, const char *path, int unlink_item) {
+    struct watch_item **link = &state->buckets[crc32c(0, (const unsigned char *)path, strlen(path)) % WATCH_BUCKETS];
+    for (; *link; link = &(*link)->next) {
+        if (strcmp((*link)->path, path) == 0) {
+            struct watch_item *item = *link;
+            if (unlink_item) {
+                *link = item->next;
+            }
+            return item;
+        }
+    }
+    return NULL;
+}
+
+// Function to put an item at the end of the queue and wake a worker. Call with the lock held.
+static void watch_push(struct watch_state *state, struct watch_item *item) {
+    item->queued = 1;
+    item->next_queued = NULL;
+    if (state->tail) {
+        state->tail->next_queued = item;
+    } else {
+        state->head = item;
+    }
+    state->tail = item;
+    pthread_cond_signal(&state->ready);
+}
+
+// Function to queue a file for ciphering, unless it is already waiting or belongs to another shard. A changed
+// file may differ from what the journal last saw finished, so that is taken back first.
+static int watch_enqueue(struct watch_state *state, const char *path, int changed) {
+    if (state->options->shard && !shard_owns(state->options->shard, path)) {
+        return 0;
+    }
+    if (changed && state->options->journal && journal_reopen(state->options->journal, path) != 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&state->lock);
+    struct watch_item *item = watch_find(state, path, 0);
+    if (!item) {
+        item = calloc(1, sizeof(*item));
+        if (!item || !(item->path = strdup(path))) {
+            pthread_mutex_unlock(&state->lock);
+            perror("Memory allocation failed for watch queue");
+            free(item);
+            return -1;
+        }
+        uint32_t bucket = crc32c(0, (const unsigned char *)path, strlen(path)) % WATCH_BUCKETS;
+        item->next = state->buckets[bucket];
+        state->buckets[bucket] = item;
+    }
+    if (!item->queued) {
+        watch_push(state, item);
+    }
+    pthread_mutex_unlock(&state->lock);
+    return 0;
+}
+
+// Worker thread: ciphers queued files until the watch stops.
+static void *watch_worker(void *arg) {
+    struct watch_state *state = arg;
+    char (*output_paths)[1024] = malloc(state->target_count * sizeof(*output_paths));
+    const char **output_path_list = malloc(state->target_count * sizeof(*output_path_list));
+    if (!output_paths || !output_path_list) {
+        perror("Memory allocation failed for output paths");
+        exit(1);
+    }
+    for (int t = 0; t < state->target_count; t++) {
+        output_path_list[t] = output_paths[t];
+    }
+
+    pthread_mutex_lock(&state->lock);
+    for (;;) {
+        while (!state->head && !state->stopping) {
+            pthread_cond_wait(&state->ready, &state->lock);
+        }
+        if (state->stopping) {
+            break;
+        }
+
+        // An item written again while it runs is queued again, but never runs twice at once
+        struct watch_item *item = state->head, **link = &state->head, *previous = NULL;
+        while (item && item->running) {
+            previous = item;
+            link = &item->next_queued;
+            item = item->next_queued;
+        }
+        if (!item) {
+            pthread_cond_wait(&state->ready, &state->lock);
+            continue;
+        }
+        *link = item->next_queued;
+        if (state->tail == item) {
+            state->tail = previous;
+        }
+        item->queued = 0;
+        item->running = 1;
+        pthread_mutex_unlock(&state->lock);
+
+        const char *relative = shard_relative(item->path, state->root_length);
+        for (int t = 0; t < state->target_count; t++) {
+            snprintf(output_paths[t], sizeof(output_paths[t]), "%s/%s", state->output_dirs[t], relative);
+        }
+        if (state->options->enable_verbosity) {
+            printf("Found file: %s\n", item->path);
+        }
+        int status = process_file(state->options, item->path, output_path_list);
+
+        pthread_mutex_lock(&state->lock);
+        if (status != 0) {
+            state->status = -1;
+        }
+        item->running = 0;
+        if (item->queued) {
+            pthread_cond_broadcast(&state->ready);
+        } else {
+            watch_find(state, item->path, 1);
+            free(item->path);
+            free(item);
+        }
+    }
+    pthread_mutex_unlock(&state->lock);
+
+    free(output_paths);
+    free(output_path_list);
+    return NULL;
+}
+
+// Recursive function to watch a directory: mirror it into the outputs, watch it, then queue its files and
+// watch its subdirectories. Watching before scanning means no file can slip in between unnoticed.
+static int watch_directory(struct watch_state *state, const char *dir_path) {
+    const char *relative = shard_relative(dir_path, state->root_length);
+    if (*relative) {
+        for (int t = 0; t < state->target_count; t++) {
+            char output_path[1024];
+            snprintf(output_path, sizeof(output_path), "%s/%s", state->output_dirs[t], relative);
+            create_directory(output_path);
+        }
+    }
+
+    int wd = inotify_add_watch(state->inotify_fd, dir_path, WATCH_EVENTS);
+    if (wd < 0) {
+        fprintf(stderr, "Error: Could not watch directory %s: %s\n", dir_path, strerror(errno));
+        return -1;
+    }
+    if (wd >= state->watched_capacity) {
+        int capacity = state->watched_capacity ? state->watched_capacity : 64;
+        while (capacity <= wd) {
+            capacity *= 2;
+        }
+        char **watched = realloc(state->watched, capacity * sizeof(*watched));
+        if (!watched) {
+            perror("Memory allocation failed for watched directories");
+            return -1;
+        }
+        memset(watched + state->watched_capacity, 0, (capacity - state->watched_capacity) * sizeof(*watched));
+        state->watched = watched;
+        state->watched_capacity = capacity;
+    }
+    // A directory renamed within the tree keeps its descriptor under the new path
+    free(state->watched[wd]);
+    state->watched[wd] = strdup(dir_path);
+    if (!state->watched[wd]) {
+        perror("Memory allocation failed for watched directories");
+        return -1;
+    }
+    if (state->options->enable_verbosity) {
+        printf("Watching directory: %s\n", dir_path);
+    }
+
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        perror("Failed to open input directory");
+        return -1;
+    }
+    int status = 0;
+    struct dirent *entry;
+    while (status == 0 && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+        status = is_directory(path) ? watch_directory(state, path) : watch_enqueue(state, path, 0);
+    }
+    closedir(dir);
+    return status;
+}
+
+// Function to handle one inotify event.
+static int watch_event(struct watch_state *state, const struct inotify_event *event, const char *input_dir) {
+    if (event->mask & IN_Q_OVERFLOW) {
+        // Events were lost, so everything is looked at again
+        fprintf(stderr, "Warning: Too many changes at once, rescanning %s\n", input_dir);
+        return watch_directory(state, input_dir);
+    }
+    if (event->wd < 0 || event->wd >= state->watched_capacity || !state->watched[event->wd]) {
+        return 0;
+    }
+    if (event->mask & IN_IGNORED) {
+        // The directory is gone, or was moved out of the tree
+        free(state->watched[event->wd]);
+        state->watched[event->wd] = NULL;
+        return 0;
+    }
+    if (!event->len) {
+        return 0;
+    }
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", state->watched[event->wd], event->name);
+    if (event->mask & IN_ISDIR) {
+        return (event->mask & (IN_CREATE | IN_MOVED_TO)) ? watch_directory(state, path) : 0;
+    }
+    // A newly created file is only ciphered once it is closed after writing
+    if (!(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))) {
+        return 0;
+    }
+    return watch_enqueue(state, path, 1);
+}
+
+// Function to cipher a directory and then every file that appears in it, until SIGINT or SIGTERM.
+int watch_tree(const struct gaius_options *options, const char *input_dir, const char *const *output_dirs, int jobs) {
+    // Outputs inside the watched tree would be ciphered again as they are written, forever
+    char *input_real = realpath(input_dir, NULL);
+    for (int t = 0; input_real && t < (options->decipher ? 1 : options->target_count); t++) {
+        char *output_real = realpath(output_dirs[t], NULL);
+        size_t length = strlen(input_real);
+        int inside = output_real && strncmp(output_real, input_real, length) == 0 && (output_real[length] == '/' || output_real[length] == '\0');
+        free(output_real);
+        if (inside) {
+            fprintf(stderr, "Error: Output directory %s is inside the watched directory.\n", output_dirs[t]);
+            free(input_real);
+            return -1;
+        }
+    }
+    free(input_real);
+
+    struct watch_state state = {0};
+    state.options = options;
+    state.root_length = strlen(input_dir);
+    state.output_dirs = output_dirs;
+    state.target_count = options->decipher ? 1 : options->target_count;
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.ready, NULL);
+
+    // The signals arrive through a descriptor, and workers inherit the mask so none of them takes one
+    sigset_t stop_signals, old_mask;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &old_mask);
+    int signal_fd = signalfd(-1, &stop_signals, SFD_CLOEXEC);
+    state.inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (signal_fd < 0 || state.inotify_fd < 0) {
+        perror("Failed to set up watch mode");
+        exit(1);
+    }
+
+    pthread_t threads[jobs];
+    int started = 0;
+    for (; started < jobs; started++) {
+        if (pthread_create(&threads[started], NULL, watch_worker, &state) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        fprintf(stderr, "Error: Could not start worker threads.\n");
+        exit(1);
+    }
+
+    int status = watch_directory(&state, input_dir);
+    if (options->enable_verbosity) {
+        printf("Watching %s with %d workers, press Ctrl+C to stop.\n", input_dir, started);
+    }
+
+    char events[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd fds[2] = {{signal_fd, POLLIN, 0}, {state.inotify_fd, POLLIN, 0}};
+    while (status == 0) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error waiting for changes");
+            status = -1;
+            break;
+        }
+        if (fds[0].revents) {
+            // Taken from the descriptor, the signal is no longer pending once the mask is restored
+            struct signalfd_siginfo info;
+            if (read(signal_fd, &info, sizeof(info)) > 0 && options->enable_verbosity) {
+                printf("Received %s.\n", strsignal(info.ssi_signo));
+            }
+            break;
+        }
+        ssize_t length = read(state.inotify_fd, events, sizeof(events));
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error reading changes");
+            status = -1;
+            break;
+        }
+        for (char *p = events; status == 0 && p < events + length;) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            status = watch_event(&state, event, input_dir);
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    if (options->enable_verbosity) {
+        printf("Stopping, waiting for files being ciphered.\n");
+    }
+    pthread_mutex_lock(&state.lock);
+    state.stopping = 1;
+    pthread_cond_broadcast(&state.ready);
+    pthread_mutex_unlock(&state.lock);
+    for (int t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    for (int b = 0; b < WATCH_BUCKETS; b++) {
+        struct watch_item *item = state.buckets[b];
+        while (item) {
+            struct watch_item *next = item->next;
+            free(item->path);
+            free(item);
+            item = next;
+        }
+    }
+    for (int wd = 0; wd < state.watched_capacity; wd++) {
+        free(state.watched[wd]);
+    }
+    free(state.watched);
+    close(state.inotify_fd);
+    close(signal_fd);
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    pthread_cond_destroy(&state.ready);
+    pthread_mutex_destroy(&state.lock);
+    return status == 0 && state.status == 0 ? 0 : -1;
+}
+#endif
+
+// Frequency analysis, used by "gaius analyze" to audit how much of the plaintext statistics leak into ciphertext.
+
+// Relative frequency of each letter in English text, in percent.
+static const double english_letter_frequency[26] = {
+    8.167, 1.492, 2.782, 4.253, 12.702, 2.228, 2.015, 6.094, 6.966, 0.153, 0.772, 4.025, 2.406,
+    6.749, 7.507, 1.929, 0.095, 5.987, 6.327, 9.056, 2.758, 0.978, 2.360, 0.150, 1.974, 0.074
+};
+
+// The most common English bigrams and their frequency in percent, used to refine candidate alphabets.
+static const struct { const char *bigram; double frequency; } english_bigrams[] = {
+    {"th", 3.56}, {"he", 3.07}, {"in", 2.43}, {"er", 2.05}, {"an", 1.99}, {"re", 1.85}, {"on", 1.76},
+    {"at", 1.49}, {"en", 1.45}, {"nd", 1.35}, {"ti", 1.34}, {"es", 1.34}, {"or", 1.28}, {"te", 1.20},
+    {"of", 1.17}, {"ed", 1.17}, {"is", 1.13}, {"it", 1.12}, {"al", 1.09}, {"ar", 1.07}, {"st", 1.05},
+    {"to", 1.04}, {"nt", 1.04}, {"ng", 0.95}, {"se", 0.93}, {"ha", 0.93}, {"as", 0.87}, {"ou", 0.87},
+    {"io", 0.83}, {"le", 0.83}, {"ve", 0.83}, {"co", 0.79}, {"me", 0.79}, {"de", 0.76}, {"hi", 0.76},
+    {"ri", 0.73}, {"ro", 0.73}, {"ic", 0.70}, {"ne", 0.69}, {"ea", 0.69}, {"ra", 0.69}, {"ce", 0.65}
+};
+
+#define ANALYZE_SEGMENT_SIZE (8 * 1024 * 1024) // Unit of work handed to a thread.
+#define ANALYZE_NO_LETTER 26                   // Bigram row/column for anything that isn't a letter.
+#define ANALYZE_LEAK_IC 0.055                  // Index of coincidence above which letters look like English.
+#define ANALYZE_MIN_LETTERS 200                // Fewer letters than this are not enough to judge.
+
+// Byte and letter bigram counts for one file, or for a whole run.
+struct analyze_histogram {
+    uint64_t bytes[256];
+    uint64_t bigrams[27 * 27]; // Indexed by letter index * 27 + letter index, case folded.
+};
+
+struct analyze_file {
+    char *path;
+    off_t size;
+    int failed; // A segment could not be read, the file is left out of the report.
+    struct analyze_histogram histogram;
+};
+
+// Shared state of an analysis run, threads take segments of files from it in order.
+struct analyze_job {
+    struct analyze_file *files;
+    size_t file_count;
+    size_t capacity;
+    size_t next_file;
+    off_t next_offset;
+    int failed;
+    pthread_mutex_t lock;
+};
+
+// Maps bytes to 0-25 for letters of either case, and ANALYZE_NO_LETTER otherwise.
+static unsigned char analyze_letter_index[256];
+
+// Function to add a file to an analysis run.
+static int analyze_add_file(struct analyze_job *job, const char *path, off_t size) {
+    if (job->file_count == job->capacity) {
+        size_t capacity = job->capacity ? job->capacity * 2 : 64;
+        struct analyze_file *files = realloc(job->files, capacity * sizeof(*files));
+        if (!files) {
+            perror("Memory allocation failed for file list");
+            return -1;
+        }
+        job->files = files;
+        job->capacity = capacity;
+    }
+    struct analyze_file *file = &job->files[job->file_count];
+    memset(file, 0, sizeof(*file));
+    file->path = strdup(path);
+    file->size = size;
+    if (!file->path) {
+        perror("Memory allocation failed for file list");
+        return -1;
+    }
+    job->file_count++;
+    return 0;
+}
+
+// Recursive function to collect the regular files below a path.
+static int analyze_collect(struct analyze_job *job, const char *path) {
+    struct stat path_stat;
+    if (stat(path, &path_stat) != 0) {
+        perror(path);
+        return -1;
+    }
+    if (S_ISREG(path_stat.st_mode)) {
+        return analyze_add_file(job, path, path_stat.st_size);
+    }
+    if (!S_ISDIR(path_stat.st_mode)) {
+        return 0;
+    }
+
+    DIR *dir = opendir(path);
+    if (!dir) {
+        perror("Failed to open input directory");
+        return -1;
+    }
+    int status = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && status == 0) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        char child[1024];
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        status = analyze_collect(job, child);
+    }
+    closedir(dir);
+    return status;
+}
+
+// Function to count bytes and letter bigrams of one segment. Four interleaved byte tables keep
+// runs of equal bytes from serializing on the same counter, so counting runs at memory bandwidth.
+// Unlike text classification and CRC32C, a histogram is a scatter of increments that SSE2 and
+// SSE4.2 have no instruction for, so this loop stays scalar.
+static void analyze_count(const unsigned char *data, size_t len, unsigned char previous,
+                          uint32_t (*byte_counts)[256], uint32_t *bigram_counts) {
+    unsigned int last = analyze_letter_index[previous];
+    size_t i = 0;
+
+    for (; i + 4 <= len; i += 4) {
+        unsigned char a = data[i], b = data[i + 1], c = data[i + 2], d = data[i + 3];
+        byte_counts[0][a]++;
+        byte_counts[1][b]++;
+        byte_counts[2][c]++;
+        byte_counts[3][d]++;
+
+        unsigned int la = analyze_letter_index[a], lb = analyze_letter_index[b];
+        unsigned int lc = analyze_letter_index[c], ld = analyze_letter_index[d];
+        bigram_counts[last * 27 + la]++;
+        bigram_counts[la * 27 + lb]++;
+        bigram_counts[lb * 27 + lc]++;
+        bigram_counts[lc * 27 + ld]++;
+        last = ld;
+    }
+    for (; i < len; i++) {
+        unsigned int l = analyze_letter_index[data[i]];
+        byte_counts[0][data[i]]++;
+        bigram_counts[last * 27 + l]++;
+        last = l;
+    }
+}
+
+// Thread body: takes segments until none are left, counting each into private tables and merging them into the file.
+static void *analyze_worker(void *arg) {
+    struct analyze_job *job = arg;
+    unsigned char *buffer = alloc_buffer(ANALYZE_SEGMENT_SIZE + 1);
+    uint32_t (*byte_counts)[256] = malloc(4 * sizeof(*byte_counts));
+    uint32_t *bigram_counts = malloc(27 * 27 * sizeof(*bigram_counts));
+
+    if (!buffer || !byte_counts || !bigram_counts) {
+        perror("Memory allocation failed for analysis buffers");
+        pthread_mutex_lock(&job->lock);
+        job->failed = 1;
+        pthread_mutex_unlock(&job->lock);
+    }
+
+    while (buffer && byte_counts && bigram_counts) {
+        // Take the next segment
+        pthread_mutex_lock(&job->lock);
+        while (job->next_file < job->file_count && job->next_offset >= job->files[job->next_file].size) {
+            job->next_file++;
+            job->next_offset = 0;
+        }
+        if (job->next_file >= job->file_count) {
+            pthread_mutex_unlock(&job->lock);
+            break;
+        }
+        struct analyze_file *file = &job->files[job->next_file];
+        off_t offset = job->next_offset;
+        size_t len = file->size - offset < ANALYZE_SEGMENT_SIZE ? (size_t)(file->size - offset) : ANALYZE_SEGMENT_SIZE;
+        job->next_offset += len;
+        pthread_mutex_unlock(&job->lock);
+
+        int fd = open(file->path, O_RDONLY);
+        if (fd < 0) {
+            perror(file->path);
+            pthread_mutex_lock(&job->lock);
+            job->failed = 1;
+            file->failed = 1;
+            pthread_mutex_unlock(&job->lock);
+            continue;
+        }
+
+        // Read one byte before the segment as well, so bigrams spanning segments are counted once
+        off_t start = offset > 0 ? offset - 1 : 0;
+        size_t want = len + (size_t)(offset - start), got = 0;
+        int read_error = 0;
+        while (got < want) {
+            ssize_t n = pread(fd, buffer + got, want - got, start + got);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                read_error = errno;
+                break;
+            }
+            if (n == 0) {
+                break; // The file shrank, count what is there
+            }
+            got += n;
+        }
+        close(fd);
+        if (read_error) {
+            // Partial statistics would look like a result, so the file is reported and the run fails
+            fprintf(stderr, "Error reading %s: %s\n", file->path, strerror(read_error));
+            pthread_mutex_lock(&job->lock);
+            job->failed = 1;
+            file->failed = 1;
+            pthread_mutex_unlock(&job->lock);
+            continue;
+        }
+
+        memset(byte_counts, 0, 4 * sizeof(*byte_counts));
+        memset(bigram_counts, 0, 27 * 27 * sizeof(*bigram_counts));
+        unsigned char previous = 0; // NUL is not a letter, so the first byte starts no bigram
+        const unsigned char *data = buffer;
+        if (offset > 0 && got > 0) {
+            previous = buffer[0];
+            data++;
+            got--;
+        }
+        analyze_count(data, got, previous, byte_counts, bigram_counts);
+
+        pthread_mutex_lock(&job->lock);
+        for (int i = 0; i < 256; i++) {
+            file->histogram.bytes[i] += (uint64_t)byte_counts[0][i] + byte_counts[1][i] + byte_counts[2][i] + byte_counts[3][i];
+        }
+        for (int i = 0; i < 27 * 27; i++) {
+            file->histogram.bigrams[i] += bigram_counts[i];
+        }
+        pthread_mutex_unlock(&job->lock);
+    }
+
+    free_buffer(buffer, ANALYZE_SEGMENT_SIZE + 1);
+    free(byte_counts);
+    free(bigram_counts);
+    return NULL;
+}
+
+// Function to compare doubles in descending order for qsort().
+static int analyze_compare_descending(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x < y) - (x > y);
+}
+
+// Function to guess a mixed alphabet from letter statistics. Cipher letters are first matched to
+// English letters by frequency rank, then pairs are swapped while that makes bigrams more English.
+// The result is in generate_mixed_alphabet() form, so it can be checked against the real keyword.
+static void analyze_recover_alphabet(const struct analyze_histogram *histogram, const uint64_t *letters, char *mixed_alphabet) {
+    static const char english_order[] = "etaoinshrdlcumwfgypbvkjxqz";
+    double weight[26][26];
+    int guess[26], order[26];
+
+    // Log-probability of each plain bigram. Unlisted ones get a tenth of what independent letters would
+    // give, since the listed bigrams already account for much of English text
+    for (int a = 0; a < 26; a++) {
+        for (int b = 0; b < 26; b++) {
+            weight[a][b] = log(english_letter_frequency[a] * english_letter_frequency[b] / 1000.0 + 0.0001);
+        }
+    }
+    for (size_t i = 0; i < sizeof(english_bigrams) / sizeof(english_bigrams[0]); i++) {
+        weight[english_bigrams[i].bigram[0] - 'a'][english_bigrams[i].bigram[1] - 'a'] = log(english_bigrams[i].frequency);
+    }
+
+    // Rank cipher letters by frequency
+    for (int i = 0; i < 26; i++) {
+        order[i] = i;
+    }
+    for (int i = 1; i < 26; i++) {
+        for (int j = i; j > 0 && letters[order[j]] > letters[order[j - 1]]; j--) {
+            int temp = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = temp;
+        }
+    }
+    for (int i = 0; i < 26; i++) {
+        guess[order[i]] = english_order[i] - 'a';
+    }
+
+    // Hill climb on bigram likelihood
+    int improved = 1;
+    while (improved) {
+        improved = 0;
+        for (int x = 0; x < 26; x++) {
+            for (int y = x + 1; y < 26; y++) {
+                double delta = 0;
+                for (int pass = 0; pass < 2; pass++) {
+                    for (int c = 0; c < 26; c++) {
+                        for (int d = 0; d < 26; d++) {
+                            if (c != x && c != y && d != x && d != y) {
+                                continue;
+                            }
+                            uint64_t count = histogram->bigrams[c * 27 + d];
+                            if (count) {
+                                delta += (pass ? 1.0 : -1.0) * count * weight[guess[c]][guess[d]];
+                            }
+                        }
+                    }
+                    int temp = guess[x];
+                    guess[x] = guess[y];
+                    guess[y] = temp;
+                }
+                // Both passes swapped, so guess is back to its original state here
+                if (delta > 1e-9) {
+                    int temp = guess[x];
+                    guess[x] = guess[y];
+                    guess[y] = temp;
+                    improved = 1;
+                }
+            }
+        }
+    }
+
+    for (int c = 0; c < 26; c++) {
+        mixed_alphabet[c] = ALPHABET[guess[c]];
+    }
+    mixed_alphabet[26] = '\0';
+}
+
+// Function to score a histogram against English and print a one-line verdict, plus a candidate alphabet if it leaks.
+static int analyze_report(const char *name, const struct analyze_histogram *histogram, int enable_verbosity) {
+    uint64_t total = 0, letter_total = 0, letters[26] = {0};
+    double entropy = 0, coincidence = 0, distance = 0;
+
+    for (int i = 0; i < 256; i++) {
+        total += histogram->bytes[i];
+        if (analyze_letter_index[i] != ANALYZE_NO_LETTER) {
+            letters[analyze_letter_index[i]] += histogram->bytes[i];
+            letter_total += histogram->bytes[i];
+        }
+    }
+    for (int i = 0; i < 256 && total; i++) {
+        if (histogram->bytes[i]) {
+            double p = (double)histogram->bytes[i] / total;
+            entropy -= p * log2(p);
+        }
+    }
+
+    // Index of coincidence and the distance between sorted letter profiles are both unchanged by
+    // a monoalphabetic substitution, so English-like values mean the plaintext statistics leak through
+    if (letter_total > 1) {
+        double observed[26], expected[26];
+        for (int i = 0; i < 26; i++) {
+            coincidence += (double)letters[i] * (letters[i] - 1);
+            observed[i] = 100.0 * letters[i] / letter_total;
+            expected[i] = english_letter_frequency[i];
+        }
+        coincidence /= (double)letter_total * (letter_total - 1);
+        qsort(observed, 26, sizeof(double), analyze_compare_descending);
+        qsort(expected, 26, sizeof(double), analyze_compare_descending);
+        for (int i = 0; i < 26; i++) {
+            distance += fabs(observed[i] - expected[i]) / 200.0;
+        }
+    }
+
+    int leaks = letter_total >= ANALYZE_MIN_LETTERS && coincidence >= ANALYZE_LEAK_IC;
+    printf("%s: %llu bytes, %llu letters, entropy %.3f bits/byte, IC %.4f, profile distance %.3f, %s\n",
+           name, (unsigned long long)total, (unsigned long long)letter_total, entropy, coincidence, distance,
+           letter_total < ANALYZE_MIN_LETTERS ? "too short" : leaks ? "LEAKS" : "ok");
+
+    if (leaks || (enable_verbosity && letter_total >= ANALYZE_MIN_LETTERS)) {
+        char mixed_alphabet[27];
+        analyze_recover_alphabet(histogram, letters, mixed_alphabet);
+        printf("    candidate mixed alphabet: %s\n", mixed_alphabet);
+    }
+    if (enable_verbosity) {
+        printf("    letters:");
+        for (int i = 0; i < 26; i++) {
+            printf(" %c=%llu", ALPHABET[i], (unsigned long long)letters[i]);
+        }
+        printf("\n");
+    }
+    return leaks;
+}
+
+// Function to run "gaius analyze <path>... [-threads <count>] [-v]".
+int analyze_paths(int argc, char *argv[]) {
+    struct analyze_job job = {0};
+    long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+    int enable_verbosity = 0;
+
+    pthread_mutex_init(&job.lock, NULL);
+    for (int i = 0; i < 256; i++) {
+        analyze_letter_index[i] = isalpha(i) ? tolower(i) - 'a' : ANALYZE_NO_LETTER;
+    }
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            enable_verbosity = 1;
+        } else if (strcmp(argv[i], "-threads") == 0) {
+            if (i + 1 < argc && atol(argv[i + 1]) > 0) {
+                thread_count = atol(argv[++i]);
+            } else {
+                fprintf(stderr, "Error: Missing or invalid value for '-threads' flag.\n");
+                return 1;
+            }
+        } else if (analyze_collect(&job, argv[i]) != 0) {
+            return 1;
+        }
+    }
+    if (job.file_count == 0) {
+        fprintf(stderr, "Usage: gaius analyze <path> [<path>...] [-threads <count>, -v]\n");
+        return 1;
+    }
+    if (thread_count < 1) {
+        thread_count = 1;
+    }
+
+    pthread_t threads[thread_count];
+    long started = 0;
+    for (; started < thread_count; started++) {
+        if (pthread_create(&threads[started], NULL, analyze_worker, &job) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        analyze_worker(&job); // Fall back to counting on this thread
+    }
+    for (long t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    struct analyze_histogram *total = calloc(1, sizeof(*total));
+    if (!total) {
+        perror("Memory allocation failed for histogram");
+        return 1;
+    }
+    size_t leaking = 0, analyzed = 0;
+    for (size_t f = 0; f < job.file_count; f++) {
+        if (job.files[f].failed) {
+            free(job.files[f].path);
+            continue;
+        }
+        analyzed++;
+        leaking += analyze_report(job.files[f].path, &job.files[f].histogram, enable_verbosity);
+        for (int i = 0; i < 256; i++) {
+            total->bytes[i] += job.files[f].histogram.bytes[i];
+        }
+        for (int i = 0; i < 27 * 27; i++) {
+            total->bigrams[i] += job.files[f].histogram.bigrams[i];
+        }
+        free(job.files[f].path);
+    }
+    if (analyzed > 1) {
+        analyze_report("total", total, enable_verbosity);
+    }
+    printf("%zu of %zu files leak English letter statistics.\n", leaking, analyzed);
+
+    free(total);
+    free(job.files);
+    pthread_mutex_destroy(&job.lock);
+    return job.failed ? 1 : 0;
+}
+
+// Ciphertext search, used by "gaius grep" to find plaintext patterns in enciphered files without deciphering them.
+// Substitution maps every byte the same way wherever it occurs, so a pattern is enciphered once and searched
+// for directly. With Base64 each 3 plaintext bytes become 4 symbols, so a pattern has three enciphered forms,
+// one per position within its 3-byte group; only the symbols it fixes entirely are searched for, and a hit is
+// confirmed by deciphering the groups around it. All needles are searched in one pass over the data, comparing
+// the first and last byte of each against 16 positions at a time. Unframed files are split into segments on
+// chunk boundaries and searched by all threads; framed files are walked frame by frame, one thread each.
+// Chunks are encoded separately, so matches spanning two chunks are looked for in the few plaintext bytes
+// deciphered from either side of each boundary.
+
+#define GREP_SEGMENT_SIZE (8 * 1024 * 1024) // Unit of work handed to a thread.
+#define GREP_MAX_PATTERN 4096
+#define GREP_SET_BASE64 0 // Needle sets, by how the bytes being searched were enciphered.
+#define GREP_SET_LETTERS 1
+#define GREP_SET_RAW 2
+
+struct grep_needle {
+    unsigned char *bytes;
+    size_t length;
+    int pattern;
+    int alignment;       // Base64: the pattern's position within its 3-byte group.
+    size_t first_symbol; // Base64: symbols of the needle's first group that come before it.
+};
+
+struct grep_needle_set {
+    struct grep_needle *needles;
+    int count;
+    size_t longest;
+};
+
+struct grep_match {
+    off_t offset;        // In the plaintext.
+    off_t cipher_offset; // In the file.
+    int pattern;
+};
+
+struct grep_file {
+    char *path;
+    off_t size;
+    int framed;
+    uint16_t flags; // Of a framed file.
+    struct grep_match *matches;
+    size_t match_count, match_capacity;
+};
+
+// Shared state of a search, threads take segments of files from it in order.
+struct grep_job {
+    struct grep_file *files;
+    size_t file_count, capacity;
+    size_t next_file;
+    off_t next_offset;
+    int failed;
+    pthread_mutex_t lock;
+    const char **patterns;
+    size_t *pattern_lengths;
+    int pattern_count;
+    struct grep_needle_set sets[3];
+    unsigned char decipher_table[256]; // Letters only, for confirming Base64 hits.
+    unsigned char decipher_raw[256];
+    size_t longest;                    // Longest pattern.
+    int unframed_set;                  // How unframed files were enciphered, from "-n64" and "-raw".
+    size_t chunk_size;                 // Plaintext chunk size of unframed Base64 files.
+};
+
+// Where a scanned region sits in its file, and what to do with hits in it.
+struct grep_region {
+    struct grep_job *job;
+    struct grep_file *file;
+    int set;
+    const unsigned char *data;
+    size_t length;
+    size_t to;            // Direct: only hits starting before this position are reported, later ones overlap the next segment.
+    off_t plain_base;     // Plaintext offset of data[0], or of its first Base64 group.
+    off_t cipher_base;    // File offset of data[0].
+    unsigned char *scratch; // Room to decipher a few Base64 groups, GREP_SCRATCH_SIZE bytes.
+    unsigned char *joined;  // Plaintext around a chunk boundary, 2 * GREP_MAX_PATTERN bytes.
+};
+
+#define GREP_SCRATCH_SIZE (base64_encoded_size(GREP_MAX_PATTERN + 2) + 4)
+
+// Function to add an enciphered needle to a set.
+static int grep_add_needle(struct grep_needle_set *set, const unsigned char *bytes, size_t length, int pattern, int alignment, size_t first_symbol) {
+    struct grep_needle *needles = realloc(set->needles, (set->count + 1) * sizeof(*needles));
+    if (!needles) {
+        perror("Memory allocation failed for search patterns");
+        return -1;
+    }
+    set->needles = needles;
+    struct grep_needle *needle = &set->needles[set->count];
+    needle->bytes = malloc(length);
+    if (!needle->bytes) {
+        perror("Memory allocation failed for search patterns");
+        return -1;
+    }
+    memcpy(needle->bytes, bytes, length);
+    needle->length = length;
+    needle->pattern = pattern;
+    needle->alignment = alignment;
+    needle->first_symbol = first_symbol;
+    if (length > set->longest) {
+        set->longest = length;
+    }
+    set->count++;
+    return 0;
+}
+
+// Function to encipher every pattern into the needles of each set.
+static int grep_build_needles(struct grep_job *job, const char *keyword) {
+    char mixed_alphabet[27], punctuation_mapping[sizeof(PUNCTUATION)];
+    unsigned char letters[256], raw[256];
+    unsigned char group[GREP_MAX_PATTERN + 2], symbols[base64_encoded_size(GREP_MAX_PATTERN + 2) + 1], needle[GREP_MAX_PATTERN];
+
+    generate_mixed_alphabet(keyword, mixed_alphabet, punctuation_mapping);
+    generate_byte_table(keyword, mixed_alphabet, 0, 0, letters);
+    generate_byte_table(keyword, mixed_alphabet, 1, 0, raw);
+    generate_byte_table(keyword, mixed_alphabet, 0, 1, job->decipher_table);
+    generate_byte_table(keyword, mixed_alphabet, 1, 1, job->decipher_raw);
+
+    for (int p = 0; p < job->pattern_count; p++) {
+        const unsigned char *pattern = (const unsigned char *)job->patterns[p];
+        size_t length = job->pattern_lengths[p];
+        if (length > job->longest) {
+            job->longest = length;
+        }
+
+        apply_table(letters, pattern, length, needle);
+        if (grep_add_needle(&job->sets[GREP_SET_LETTERS], needle, length, p, 0, 0) != 0) {
+            return -1;
+        }
+        apply_table(raw, pattern, length, needle);
+        if (grep_add_needle(&job->sets[GREP_SET_RAW], needle, length, p, 0, 0) != 0) {
+            return -1;
+        }
+
+        // Behind alignment filler bytes, symbols from the first whole one after the filler to the last whole
+        // one before the pattern ends depend on the pattern alone
+        for (int alignment = 0; alignment < 3; alignment++) {
+            memset(group, 0, alignment);
+            memcpy(group + alignment, pattern, length);
+            base64_encode_into(group, alignment + length, (char *)symbols);
+            size_t first = (8 * alignment + 5) / 6, end = 8 * (alignment + length) / 6;
+            apply_table(letters, symbols + first, end - first, needle);
+            if (grep_add_needle(&job->sets[GREP_SET_BASE64], needle, end - first, p, alignment, first) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Function to record a match of a file.
+static void grep_add_match(struct grep_region *region, off_t offset, off_t cipher_offset, int pattern) {
+    struct grep_file *file = region->file;
+
+    pthread_mutex_lock(&region->job->lock);
+    if (file->match_count == file->match_capacity) {
+        size_t capacity = file->match_capacity ? file->match_capacity * 2 : 16;
+        struct grep_match *matches = realloc(file->matches, capacity * sizeof(*matches));
+        if (!matches) {
+            perror("Memory allocation failed for matches");
+            region->job->failed = 1;
+            pthread_mutex_unlock(&region->job->lock);
+            return;
+        }
+        file->matches = matches;
+        file->match_capacity = capacity;
+    }
+    file->matches[file->match_count++] = (struct grep_match){offset, cipher_offset, pattern};
+    pthread_mutex_unlock(&region->job->lock);
+}
+
+// Function to check a hit of a needle at a position of a region, recording it if it is a match.
+static void grep_hit(struct grep_region *region, const struct grep_needle *needle, size_t position) {
+    if (region->set != GREP_SET_BASE64) {
+        if (position < region->to) {
+            grep_add_match(region, region->plain_base + (off_t)position, region->cipher_base + (off_t)position, needle->pattern);
+        }
+        return;
+    }
+
+    // The needle has to sit where its group starts on a group boundary, and deciphering the groups it spans
+    // has to give back the pattern, as the partly fixed symbols around the needle were not compared
+    if (position < needle->first_symbol || (position - needle->first_symbol) % 4 != 0) {
+        return;
+    }
+    size_t start = position - needle->first_symbol;
+    size_t length = region->job->pattern_lengths[needle->pattern];
+    size_t symbols = base64_encoded_size(needle->alignment + length);
+    if (start + symbols > region->length) {
+        return;
+    }
+    apply_table(region->job->decipher_table, region->data + start, symbols, region->scratch);
+    size_t decoded = base64_decode_into((const char *)region->scratch, symbols, region->scratch);
+    if (decoded < needle->alignment + length || memcmp(region->scratch + needle->alignment, region->job->patterns[needle->pattern], length) != 0) {
+        return;
+    }
+    grep_add_match(region, region->plain_base + (off_t)(start / 4 * 3 + needle->alignment), region->cipher_base + (off_t)start, needle->pattern);
+}
+
+// Function to find every needle of the region's set in its data.
+static void grep_scan(struct grep_region *region) {
+    const struct grep_needle_set *set = &region->job->sets[region->set];
+    const unsigned char *data = region->data;
+    size_t len = region->length, i = 0;
+
+#ifdef __SSE2__
+    // Compare the first and last byte of every needle at 16 positions at once, the rest only where both match
+    if (len >= set->longest + 15) {
+        __m128i firsts[set->count], lasts[set->count];
+        for (int k = 0; k < set->count; k++) {
+            firsts[k] = _mm_set1_epi8((char)set->needles[k].bytes[0]);
+            lasts[k] = _mm_set1_epi8((char)set->needles[k].bytes[set->needles[k].length - 1]);
+        }
+        for (; i + 15 + set->longest <= len; i += 16) {
+            __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+            for (int k = 0; k < set->count; k++) {
+                const struct grep_needle *needle = &set->needles[k];
+                __m128i tail = _mm_loadu_si128((const __m128i *)(data + i + needle->length - 1));
+                unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block, firsts[k]), _mm_cmpeq_epi8(tail, lasts[k])));
+                while (mask) {
+                    size_t position = i + __builtin_ctz(mask);
+                    if (memcmp(data + position + 1, needle->bytes + 1, needle->length - 1) == 0) {
+                        grep_hit(region, needle, position);
+                    }
+                    mask &= mask - 1;
+                }
+            }
+        }
+    }
+#endif
+    for (; i < len; i++) {
+        for (int k = 0; k < set->count; k++) {
+            const struct grep_needle *needle = &set->needles[k];
+            if (data[i] == needle->bytes[0] && i + needle->length <= len && memcmp(data + i + 1, needle->bytes + 1, needle->length - 1) == 0) {
+                grep_hit(region, needle, i);
+            }
+        }
+    }
+}
+
+// Function to decipher up to want plaintext bytes from the start, or the end, of one enciphered chunk.
+static size_t grep_chunk_plain(const struct grep_job *job, int set, const unsigned char *data, size_t length, int end,
+                               size_t want, unsigned char *scratch, unsigned char *plain) {
+    if (set != GREP_SET_BASE64) {
+        size_t n = length < want ? length : want;
+        apply_table(set == GREP_SET_RAW ? job->decipher_raw : job->decipher_table, end ? data + length - n : data, n, plain);
+        return n;
+    }
+
+    // Whole groups are deciphered, starting from the one holding the first byte wanted
+    size_t start = 0, skip = 0;
+    if (end) {
+        size_t padding = length >= 2 ? (data[length - 1] == '=') + (data[length - 2] == '=') : 0;
+        size_t plain_length = length / 4 * 3 - padding;
+        size_t first = plain_length > want ? plain_length - want : 0;
+        start = first / 3 * 4;
+        skip = first % 3;
+    }
+    size_t symbols = length - start < base64_encoded_size(want + skip) ? length - start : base64_encoded_size(want + skip);
+    apply_table(job->decipher_table, data + start, symbols, scratch);
+    size_t decoded = base64_decode_into((const char *)scratch, symbols, scratch);
+    size_t n = decoded > skip ? decoded - skip : 0;
+    n = n < want ? n : want;
+    memcpy(plain, scratch + skip, n);
+    return n;
+}
+
+// Function to find the matches spanning a chunk boundary, from the plaintext just before and just after it.
+static void grep_boundary(struct grep_region *region, const unsigned char *before, size_t before_length,
+                          const unsigned char *after, size_t after_length, off_t boundary, off_t cipher_boundary) {
+    memcpy(region->joined, before, before_length);
+    memcpy(region->joined + before_length, after, after_length);
+    for (int p = 0; p < region->job->pattern_count; p++) {
+        size_t length = region->job->pattern_lengths[p];
+        size_t first = before_length >= length ? before_length - length + 1 : 0;
+        for (size_t s = first; s < before_length && s + length <= before_length + after_length; s++) {
+            if (memcmp(region->joined + s, region->job->patterns[p], length) == 0) {
+                grep_add_match(region, boundary - (off_t)(before_length - s), cipher_boundary, p);
+            }
+        }
+    }
+}
+
+// Function to search a framed file frame by frame, keeping the end of each chunk's plaintext for the boundary
+// with the next.
+static int grep_framed_file(struct grep_job *job, struct grep_file *file, unsigned char *scratch, unsigned char *joined) {
+    FILE *fp = fopen(file->path, "rb");
+    if (!fp) {
+        perror(file->path);
+        return -1;
+    }
+    uint16_t flags = file->flags;
+    size_t header_size = frame_header_size(flags);
+    size_t want = job->longest - 1;
+    unsigned char frame_header[GAIUS_MAX_FRAME_HEADER_SIZE];
+    unsigned char tail[GREP_MAX_PATTERN], head[GREP_MAX_PATTERN];
+    unsigned char *buffer = NULL;
+    size_t capacity = 0, tail_length = 0, got;
+    off_t frame_offset = GAIUS_HEADER_SIZE, plain_offset = 0;
+    int status = 0;
+
+    if (fseeko(fp, GAIUS_HEADER_SIZE, SEEK_SET) != 0) {
+        fprintf(stderr, "Error reading %s: %s\n", file->path, strerror(errno));
+        status = -1;
+    }
+    while (status == 0 && (got = fread(frame_header, 1, header_size, fp)) > 0) {
+        size_t len = got == header_size ? read_le32(frame_header) : 0;
+        unsigned char tag = (flags & GAIUS_FLAG_ADAPTIVE) ? frame_header[header_size - 1] : GAIUS_CHUNK_BASE64;
+        if (len > capacity) {
+            unsigned char *grown = realloc(buffer, len);
+            if (!grown) {
+                perror("Memory allocation failed for buffers");
+                status = -1;
+                break;
+            }
+            buffer = grown;
+            capacity = len;
+        }
+        if (got != header_size || fread(buffer, 1, len, fp) != len) {
+            if (!ferror(fp)) {
+                fprintf(stderr, "Error: Truncated chunk at offset %lld in file: %s\n", (long long)frame_offset, file->path);
+            }
+            status = -1;
+            break;
+        }
+        frame_offset += header_size;
+
+        int set = (flags & GAIUS_FLAG_RAW) ? GREP_SET_RAW : (flags & GAIUS_FLAG_NO_BASE64) || tag == GAIUS_CHUNK_TEXT ? GREP_SET_LETTERS : GREP_SET_BASE64;
+        struct grep_region region = {job, file, set, buffer, len, len, plain_offset, frame_offset, scratch, joined};
+        grep_scan(&region);
+        if (tail_length) {
+            size_t head_length = grep_chunk_plain(job, set, buffer, len, 0, want, scratch, head);
+            grep_boundary(&region, tail, tail_length, head, head_length, plain_offset, frame_offset);
+        }
+
+        // A chunk shorter than the longest pattern adds to the plaintext kept from the chunks before it
+        size_t added = grep_chunk_plain(job, set, buffer, len, 1, want, scratch, head);
+        if (tail_length + added > want) {
+            size_t keep = want > added ? want - added : 0;
+            memmove(tail, tail + tail_length - keep, keep);
+            tail_length = keep;
+        }
+        memcpy(tail + tail_length, head, added);
+        tail_length += added;
+
+        if (set == GREP_SET_BASE64) {
+            size_t padding = len >= 2 ? (buffer[len - 1] == '=') + (buffer[len - 2] == '=') : 0;
+            plain_offset += len / 4 * 3 - padding;
+        } else {
+            plain_offset += len;
+        }
+        frame_offset += len;
+    }
+    if (ferror(fp)) {
+        fprintf(stderr, "Error reading %s: %s\n", file->path, strerror(errno));
+        status = -1;
+    }
+
+    free(buffer);
+    fclose(fp);
+    return status;
+}
+
+// Function to add a file to a search, noting whether it is framed.
+static int grep_add_file(struct grep_job *job, const char *path, off_t size) {
+    if (job->file_count == job->capacity) {
+        size_t capacity = job->capacity ? job->capacity * 2 : 64;
+        struct grep_file *files = realloc(job->files, capacity * sizeof(*files));
+        if (!files) {
+            perror("Memory allocation failed for file list");
+            return -1;
+        }
+        job->files = files;
+        job->capacity = capacity;
+    }
+    struct grep_file *file = &job->files[job->file_count];
+    memset(file, 0, sizeof(*file));
+    file->path = strdup(path);
+    file->size = size;
+    if (!file->path) {
+        perror("Memory allocation failed for file list");
+        return -1;
+    }
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        perror(path);
+        free(file->path);
+        return -1;
+    }
+    file->framed = read_frame_header(fp, &file->flags);
+    fclose(fp);
+    if (file->framed < 0) {
+        fprintf(stderr, "Error: Unsupported format version in file: %s\n", path);
+        free(file->path);
+        return -1;
+    }
+    job->file_count++;
+    return 0;
+}
+
+// Recursive function to collect the regular files below a path.
+static int grep_collect(struct grep_job *job, const char *path) {
+    struct stat path_stat;
+    if (stat(path, &path_stat) != 0) {
+        perror(path);
+        return -1;
+    }
+    if (S_ISREG(path_stat.st_mode)) {
+        return grep_add_file(job, path, path_stat.st_size);
+    }
+    if (!S_ISDIR(path_stat.st_mode)) {
+        return 0;
+    }
+
+    DIR *dir = opendir(path);
+    if (!dir) {
+        perror("Failed to open input directory");
+        return -1;
+    }
+    int status = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && status == 0) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        char child[1024];
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        status = grep_collect(job, child);
+    }
+    closedir(dir);
+    return status;
+}
+
+// Thread body: takes segments until none are left and searches them.
+static void *grep_worker(void *arg) {
+    struct grep_job *job = arg;
+    size_t cipher_chunk = base64_encoded_size(job->chunk_size);
+    int base64 = job->unframed_set == GREP_SET_BASE64;
+    size_t segment = base64 ? (GREP_SEGMENT_SIZE / cipher_chunk + 1) * cipher_chunk : GREP_SEGMENT_SIZE;
+    // Direct matches may run into the next segment, Base64 segments end on chunk boundaries and only need
+    // enough of the next chunk to decipher the plaintext after the boundary
+    size_t overlap = base64 ? base64_encoded_size(job->longest) : job->longest - 1;
+    unsigned char *buffer = alloc_buffer(segment + overlap);
+    unsigned char *scratch = malloc(GREP_SCRATCH_SIZE);
+    unsigned char *joined = malloc(4 * GREP_MAX_PATTERN);
+
+    if (!buffer || !scratch || !joined) {
+        perror("Memory allocation failed for search buffers");
+        pthread_mutex_lock(&job->lock);
+        job->failed = 1;
+        pthread_mutex_unlock(&job->lock);
+    }
+
+    while (buffer && scratch && joined) {
+        // Take the next segment, or the whole of a framed file
+        pthread_mutex_lock(&job->lock);
+        while (job->next_file < job->file_count && job->next_offset >= job->files[job->next_file].size) {
+            job->next_file++;
+            job->next_offset = 0;
+        }
+        if (job->next_file >= job->file_count) {
+            pthread_mutex_unlock(&job->lock);
+            break;
+        }
+        struct grep_file *file = &job->files[job->next_file];
+        off_t offset = job->next_offset;
+        size_t len = file->size - offset < (off_t)segment ? (size_t)(file->size - offset) : segment;
+        job->next_offset = file->framed ? file->size : offset + (off_t)len;
+        pthread_mutex_unlock(&job->lock);
+
+        if (file->framed) {
+            if (grep_framed_file(job, file, scratch, joined) != 0) {
+                pthread_mutex_lock(&job->lock);
+                job->failed = 1;
+                pthread_mutex_unlock(&job->lock);
+            }
+            continue;
+        }
+
+        int fd = open(file->path, O_RDONLY);
+        if (fd < 0) {
+            perror(file->path);
+            pthread_mutex_lock(&job->lock);
+            job->failed = 1;
+            pthread_mutex_unlock(&job->lock);
+            continue;
+        }
+        size_t want = len + overlap, got = 0;
+        int read_error = 0;
+        while (got < want) {
+            ssize_t n = pread(fd, buffer + got, want - got, offset + got);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                read_error = errno;
+                break;
+            }
+            if (n == 0) {
+                break; // End of file, the last segment has no overlap
+            }
+            got += n;
+        }
+        close(fd);
+        // Like grep(1), an unreadable file is an error and not a file without matches
+        if (read_error) {
+            fprintf(stderr, "Error reading %s: %s\n", file->path, strerror(read_error));
+            pthread_mutex_lock(&job->lock);
+            job->failed = 1;
+            pthread_mutex_unlock(&job->lock);
+            continue;
+        }
+
+        struct grep_region region = {job, file, job->unframed_set, buffer, got, len, offset, offset, scratch, joined};
+        if (!base64) {
+            grep_scan(&region);
+            continue;
+        }
+        size_t end = got < len ? got : len;
+        for (size_t start = 0; start < end; start += cipher_chunk) {
+            region.data = buffer + start;
+            region.length = end - start < cipher_chunk ? end - start : cipher_chunk;
+            region.plain_base = (offset + (off_t)start) / (off_t)cipher_chunk * (off_t)job->chunk_size;
+            region.cipher_base = offset + (off_t)start;
+            grep_scan(&region);
+
+            // Only a full chunk with more after it has a boundary
+            size_t next = start + cipher_chunk;
+            if (next < got) {
+                unsigned char *before = joined + 2 * GREP_MAX_PATTERN, *after = before + GREP_MAX_PATTERN;
+                size_t before_length = grep_chunk_plain(job, GREP_SET_BASE64, region.data, region.length, 1, job->longest - 1, scratch, before);
+                size_t after_length = grep_chunk_plain(job, GREP_SET_BASE64, buffer + next, got - next < cipher_chunk ? got - next : cipher_chunk, 0,
+                                                       job->longest - 1, scratch, after);
+                grep_boundary(&region, before, before_length, after, after_length, region.plain_base + (off_t)job->chunk_size, offset + (off_t)next);
+            }
+        }
+    }
+
+    free_buffer(buffer, segment + overlap);
+    free(scratch);
+    free(joined);
+    return NULL;
+}
+
+// Function to order matches by offset, then pattern.
+static int grep_compare_matches(const void *a, const void *b) {
+    const struct grep_match *ma = a, *mb = b;
+    if (ma->offset != mb->offset) {
+        return ma->offset < mb->offset ? -1 : 1;
+    }
+    return ma->pattern - mb->pattern;
+}
+
+// Function to run "gaius grep <password|keyword> <pattern> <path>... [-e <pattern>, -n64, -raw, -chunk <size>, -threads <count>, -count, -v]".
+int grep_paths(int argc, char *argv[]) {
+    struct grep_job job = {0};
+    long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+    int enable_verbosity = 0, count_only = 0, disable_base64 = 0, enable_raw = 0;
+    const char *patterns[argc];
+    size_t pattern_lengths[argc];
+    const char *paths[argc];
+    int path_count = 0;
+
+    if (argc < 5) {
+        fprintf(stderr, "Usage: gaius grep <password|keyword> <pattern> <path> [<path>...] [-e <pattern>, -n64, -raw, -chunk <size>, -threads <count>, -count, -v]\n");
+        return 2;
+    }
+    if (!validate_password(argv[2])) {
+        fprintf(stderr, "Error: Password must be at least 8 characters long, contain at least 1 special character, and 1 integer.\n");
+        return 2;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+    job.patterns = patterns;
+    job.pattern_lengths = pattern_lengths;
+    job.chunk_size = DEFAULT_BUFFER_SIZE;
+    patterns[job.pattern_count++] = argv[3];
+
+    // Paths are searched once every flag is known, the flags may come after them
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            enable_verbosity = 1;
+        } else if (strcmp(argv[i], "-count") == 0) {
+            count_only = 1;
+        } else if (strcmp(argv[i], "-n64") == 0) {
+            disable_base64 = 1;
+        } else if (strcmp(argv[i], "-raw") == 0) {
+            enable_raw = 1;
+            disable_base64 = 1;
+        } else if (strcmp(argv[i], "-e") == 0) {
+            if (i + 1 < argc) {
+                patterns[job.pattern_count++] = argv[++i];
+            } else {
+                fprintf(stderr, "Error: Missing pattern for '-e' flag.\n");
+                return 2;
+            }
+        } else if (strcmp(argv[i], "-chunk") == 0) {
+            if (i + 1 < argc && parse_size(argv[i + 1], &job.chunk_size) == 0 && job.chunk_size >= 1024 && job.chunk_size <= SIZE_MAX / 4) {
+                i++;
+            } else {
+                fprintf(stderr, "Error: Missing or invalid value for '-chunk' flag.\n");
+                return 2;
+            }
+        } else if (strcmp(argv[i], "-threads") == 0) {
+            if (i + 1 < argc && atol(argv[i + 1]) > 0) {
+                thread_count = atol(argv[++i]);
+            } else {
+                fprintf(stderr, "Error: Missing or invalid value for '-threads' flag.\n");
+                return 2;
+            }
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Error: Unknown flag '%s'.\n", argv[i]);
+            return 2;
+        } else {
+            paths[path_count++] = argv[i];
+        }
+    }
+    for (int p = 0; p < job.pattern_count; p++) {
+        pattern_lengths[p] = strlen(patterns[p]);
+        if (pattern_lengths[p] < 2 || pattern_lengths[p] > GREP_MAX_PATTERN) {
+            fprintf(stderr, "Error: Patterns must be 2 to %d bytes long.\n", GREP_MAX_PATTERN);
+            return 2;
+        }
+    }
+    job.unframed_set = enable_raw ? GREP_SET_RAW : disable_base64 ? GREP_SET_LETTERS : GREP_SET_BASE64;
+    if (grep_build_needles(&job, argv[2]) != 0) {
+        return 2;
+    }
+    for (int p = 0; p < path_count; p++) {
+        if (grep_collect(&job, paths[p]) != 0) {
+            return 2;
+        }
+    }
+    if (job.file_count == 0) {
+        fprintf(stderr, "Error: No files to search.\n");
+        return 2;
+    }
+
+    if (thread_count < 1) {
+        thread_count = 1;
+    }
+    pthread_t threads[thread_count];
+    long started = 0;
+    for (; started < thread_count; started++) {
+        if (pthread_create(&threads[started], NULL, grep_worker, &job) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        grep_worker(&job); // Fall back to searching on this thread
+    }
+    for (long t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    size_t total = 0;
+    for (size_t f = 0; f < job.file_count; f++) {
+        struct grep_file *file = &job.files[f];
+        qsort(file->matches, file->match_count, sizeof(*file->matches), grep_compare_matches);
+        total += file->match_count;
+        if (count_only) {
+            printf("%s:%zu\n", file->path, file->match_count);
+        }
+        for (size_t m = 0; m < file->match_count && !count_only; m++) {
+            printf("%s:%lld", file->path, (long long)file->matches[m].offset);
+            if (job.pattern_count > 1) {
+                printf(":%s", patterns[file->matches[m].pattern]);
+            }
+            if (enable_verbosity) {
+                printf(" (ciphertext offset %lld)", (long long)file->matches[m].cipher_offset);
+            }
+            printf("\n");
+        }
+        free(file->matches);
+        free(file->path);
+    }
+    if (enable_verbosity) {
+        printf("%zu matches in %zu files.\n", total, job.file_count);
+    }
+
+    for (int s = 0; s < 3; s++) {
+        for (int k = 0; k < job.sets[s].count; k++) {
+            free(job.sets[s].needles[k].bytes);
+        }
+        free(job.sets[s].needles);
+    }
+    free(job.files);
+    pthread_mutex_destroy(&job.lock);
+    return job.failed ? 2 : total ? 0 : 1;
+}
+
+// Function to derive a target's mixed alphabet and substitution table from its keyword.
+static void prepare_target(struct gaius_target *target, const struct gaius_options *options) {
+    generate_mixed_alphabet(target->keyword, target->mixed_alphabet, target->punctuation_mapping);
+    generate_byte_table(target->keyword, target->mixed_alphabet, options->enable_raw, options->decipher, target->table);
+    generate_fused_tables(target->table, target->encode_table, target->decode_table);
+}
+
+// Main function to process arguments.
+int main(int argc, char *argv[]) {
+    struct gaius_options options = {0};
+    int resume = 0;
+    size_t max_read_rate = 0, max_write_rate = 0;
+    int max_cpu = 0, idle_io = 0, nice_level = 0, set_nice = 0;
+    int shard_index = 0, shard_count = 0, shard_balance = 0;
+    int watch = 0;
+    long jobs = 0;
+    int show_progress = 0;
+    struct gaius_progress progress = {0};
+
+    if (argc >= 2 && strcmp(argv[1], "analyze") == 0) {
+        return analyze_paths(argc, argv);
+    }
+    if (argc >= 2 && strcmp(argv[1], "grep") == 0) {
+        return grep_paths(argc, argv);
+    }
+
+    options.buffer_size = DEFAULT_BUFFER_SIZE;
+    options.space_check = 1;
+
+    // Every "-key" adds one target, the command line keyword and output are always the first
+    struct gaius_target *targets = calloc(argc > 5 ? argc - 3 : 2, sizeof(*targets));
+    if (!targets) {
+        perror("Memory allocation failed for targets");
+        return 1;
+    }
+    options.targets = targets;
+    options.target_count = 1;
+
+    // Parse optional flags
+    for (int i = 5; i < argc; i++) {
+        if (strcmp(argv[i], "-n64") == 0) {
+            options.disable_base64 = 1;
+        } else if (strcmp(argv[i], "-v") == 0) {
+            options.enable_verbosity = 1;
+        } else if (strcmp(argv[i], "-crc") == 0) {
+            options.enable_crc = 1;
+        } else if (strcmp(argv[i], "-adaptive") == 0) {
+            options.enable_adaptive = 1;
+        } else if (strcmp(argv[i], "-raw") == 0) {
+            // Raw mode substitutes every byte value, so Base64 is never needed
+            options.enable_raw = 1;
+            options.disable_base64 = 1;
+        } else if (strcmp(argv[i], "-dedup") == 0) {
+            options.dedup = calloc(1, sizeof(struct dedup_index));
+            if (!options.dedup) {
+                perror("Memory allocation failed for duplicate index");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-lines") == 0) {
+            options.line_mode = 1;
+        } else if (strcmp(argv[i], "-csv") == 0 || strcmp(argv[i], "-jsonl") == 0) {
+            // Ensure a field list follows the flag
+            if (i + 1 < argc) {
+                int format = strcmp(argv[i], "-csv") == 0 ? FIELDS_CSV : FIELDS_JSONL;
+                options.fields = parse_fields(format, argv[++i]);
+                if (!options.fields) {
+                    return 1;
+                }
+                options.line_mode = 1;
+            } else {
+                fprintf(stderr, "Error: Missing field list for '%s' flag.\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-follow") == 0) {
+            options.follow = 1;
+        } else if (strcmp(argv[i], "-max-read-rate") == 0 || strcmp(argv[i], "-max-write-rate") == 0) {
+            // Ensure a rate follows the flag
+            size_t *rate = strcmp(argv[i], "-max-read-rate") == 0 ? &max_read_rate : &max_write_rate;
+            if (i + 1 < argc) {
+                if (parse_size(argv[++i], rate) != 0 || *rate == 0) {
+                    fprintf(stderr, "Error: Invalid rate '%s'. Must be a positive number of bytes per second, optionally suffixed with K, M or G.\n", argv[i]);
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Error: Missing value for '%s' flag.\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-max-cpu") == 0) {
+            // Ensure a percentage follows the "-max-cpu" flag
+            if (i + 1 < argc) {
+                max_cpu = atoi(argv[++i]);
+                if (max_cpu < 1 || max_cpu > 100) {
+                    fprintf(stderr, "Error: Invalid CPU limit '%s'. Must be a percentage from 1 to 100.\n", argv[i]);
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Error: Missing value for '-max-cpu' flag.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-direct") == 0) {
+            options.direct_io = 1;
+        } else if (strcmp(argv[i], "-idle") == 0) {
+            idle_io = 1;
+        } else if (strcmp(argv[i], "-nice") == 0) {
+            // Ensure a niceness follows the "-nice" flag
+            if (i + 1 < argc) {
+                nice_level = atoi(argv[++i]);
+                set_nice = 1;
+            } else {
+                fprintf(stderr, "Error: Missing value for '-nice' flag.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-resume") == 0) {
+            resume = 1;
+        } else if (strcmp(argv[i], "-shard") == 0) {
+            // Ensure a shard of the form i/N follows the "-shard" flag
+            if (i + 1 < argc) {
+                if (parse_shard(argv[++i], &shard_index, &shard_count) != 0) {
+                    fprintf(stderr, "Error: Invalid shard '%s'. Must be i/N with 1 <= i <= N <= %d.\n", argv[i], SHARD_MAX);
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Error: Missing value for '-shard' flag.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-shard-balance") == 0) {
+            shard_balance = 1;
+        } else if (strcmp(argv[i], "-watch") == 0) {
+            watch = 1;
+        } else if (strcmp(argv[i], "-jobs") == 0) {
+            if (i + 1 < argc && atol(argv[i + 1]) > 0) {
+                jobs = atol(argv[++i]);
+            } else {
+                fprintf(stderr, "Error: Missing or invalid value for '-jobs' flag.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-progress") == 0) {
+            show_progress = 1;
+        } else if (strcmp(argv[i], "-no-space-check") == 0) {
+            options.space_check = 0;
+        } else if (strcmp(argv[i], "-key") == 0) {
+            // Ensure a keyword and an output path follow the "-key" flag
+            if (i + 2 < argc) {
+                targets[options.target_count].keyword = argv[++i];
+                targets[options.target_count].output_path = argv[++i];
+                options.target_count++;
+            } else {
+                fprintf(stderr, "Error: Missing keyword or output path for '-key' flag.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-chunk") == 0) {
+            // Ensure a value follows the "-chunk" flag
+            if (i + 1 < argc) {
+                if (parse_size(argv[++i], &options.buffer_size) != 0 || options.buffer_size == 0) {
+                    fprintf(stderr, "Error: Invalid buffer size '%s'. Must be a positive integer, optionally suffixed with K, M or G.\n", argv[i]);
+                    return 1;
+                }
+                // Ensure the buffer_size is at least 1024 bytes
+                if (options.buffer_size < 1024) {
+                    fprintf(stderr, "Error: Buffer size cannot be less than 1024 bytes. Setting to 1024 bytes.\n");
+                    options.buffer_size = 1024;
+                }
+                // Leave room for the Base64 expansion without overflowing size_t
+                if (options.buffer_size > SIZE_MAX / 4) {
+                    fprintf(stderr, "Error: Buffer size '%s' is too large.\n", argv[i]);
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Error: Missing value for '-chunk' flag.\n");
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Error: Unknown flag '%s'.\n", argv[i]);
+            return 1;
+        }
+    }
+
+    // Adaptive mode chooses between Base64 and direct substitution, so it needs Base64 to be on
+    if (options.enable_adaptive && options.disable_base64) {
+        fprintf(stderr, "Error: The '-adaptive' flag cannot be combined with '-n64' or '-raw'.\n");
+        return 1;
+    }
+
+    // Records are delimited by newlines, which raw mode would substitute and framing would bury in chunks
+    if (options.line_mode && (options.enable_raw || options.enable_crc || options.enable_adaptive || options.dedup || resume)) {
+        fprintf(stderr, "Error: Record mode ('-lines', '-csv', '-jsonl') cannot be combined with '-raw', '-crc', '-adaptive', '-dedup' or '-resume'.\n");
+        return 1;
+    }
+    if (shard_balance && !shard_count) {
+        fprintf(stderr, "Error: The '-shard-balance' flag requires '-shard'.\n");
+        return 1;
+    }
+    // Workers share nothing but the journal and throttle, a duplicate index or fixed shard plan cannot follow new files
+    if (watch && (options.dedup || shard_balance)) {
+        fprintf(stderr, "Error: The '-watch' flag cannot be combined with '-dedup' or '-shard-balance'.\n");
+        return 1;
+    }
+    // The duplicate index is filled as files are processed, one at a time
+    if (jobs > 1 && options.dedup) {
+        fprintf(stderr, "Error: The '-jobs' flag cannot be combined with '-dedup'.\n");
+        return 1;
+    }
+    options.jobs = jobs ? (int)jobs : watch ? (int)sysconf(_SC_NPROCESSORS_ONLN) : 1;
+    // A watch or a stream has no total to measure against
+    if (show_progress && (watch || options.line_mode)) {
+        fprintf(stderr, "Error: The '-progress' flag cannot be combined with '-watch' or record mode.\n");
+        return 1;
+    }
+    options.progress = show_progress ? &progress : NULL;
+    if (options.follow && !options.line_mode) {
+        fprintf(stderr, "Error: The '-follow' flag requires '-lines', '-csv' or '-jsonl'.\n");
+        return 1;
+    }
+
+    // Framed chunk lengths are stored in 32 bits
+    if ((options.enable_crc || options.enable_adaptive) && options.buffer_size > GAIUS_MAX_FRAMED_CHUNK) {
+        fprintf(stderr, "Error: Buffer size cannot exceed 3 GB when checksums or adaptive mode are enabled.\n");
+        return 1;
+    }
+
+    // Validate argument count
+    if (argc < 5) {
+        fprintf(stderr,
+                "Gaius V1.1 - A cryptography tool which implements a new complex mixed substitution cipher dubbed 'Gaius Cipher' into binary/plaintext data structures.\n\n\n"
+                "Usage: gaius <encipher|decipher> <password|keyword> <input_file> <output_file> [-n64, -v, -chunk <size>, -crc, -raw, -key <password|keyword> <output_file>, -dedup, -adaptive, -resume, -lines, -follow, -csv <columns>, -jsonl <keys>,\n"
+                "       -max-read-rate <size>, -max-write-rate <size>, -max-cpu <percent>, -idle, -nice <level>, -direct,\n"
+                "       -shard <i/N>, -shard-balance, -watch, -jobs <count>, -progress, -no-space-check]\n"
+                "       gaius analyze <path> [<path>...] [-threads <count>, -v]\n"
+                "       gaius grep <password|keyword> <pattern> <path> [<path>...] [-e <pattern>, -n64, -raw, -chunk <size>, -threads <count>, -count, -v]\n\n"
+                "Optional Usage: \n\n"
+                "-n64    Disables utilization of base64 in the cipher process.\n"
+                "-v      Enables verbose output for debugging.\n"
+                "-chunk  Specifies the buffer size for processing files, K/M/G suffixes allowed (default: 4096 bytes).\n"
+                "-crc    Stores a CRC32C checksum with every chunk, verified automatically when deciphering.\n"
+                "-raw    Ciphers every byte value with a keyword derived permutation, output stays the size of the input.\n"
+                "-key    Also enciphers the input under another keyword into another output, may be repeated.\n"
+                "-dedup  In directory mode, hardlinks and identical files are ciphered once and linked or cloned in the output.\n"
+                "-adaptive  Skips Base64 for chunks that are already printable text, and tags each chunk so decipher knows.\n"
+                "-resume    Continues an interrupted run from its journal, skipping finished files and resuming the rest from their last checkpoint.\n"
+                "-lines     Ciphers each line as its own record and writes it out right away, '-' as input or output means stdin or stdout.\n"
+                "-follow    With '-lines', keeps reading as the input file grows instead of stopping at its end.\n"
+                "-csv       Ciphers only the listed CSV columns (1-based numbers, or names from the header row) of each record.\n"
+                "-jsonl     Ciphers only the listed top-level keys of each JSON-lines record, other bytes are left as they are.\n"
+                "-max-read-rate, -max-write-rate  Limit file reads or writes to the given bytes per second, K/M/G suffixes allowed.\n"
+                "-max-cpu   Limits CPU use to the given percentage of one core.\n"
+                "-idle      Only uses the disk when no other process needs it (idle I/O scheduling class).\n"
+                "-nice      Runs at the given nice level, 19 being the lowest priority.\n"
+                "-direct    Reads and writes files with O_DIRECT, bypassing the page cache for very large jobs.\n"
+                "-shard     In directory mode, handles only shard i of N, chosen by a hash of each file's relative path, so N runs split a tree.\n"
+                "-shard-balance  With '-shard', assigns files so the shards are close in total size instead of hashing paths.\n"
+                "-watch     After ciphering a directory, keeps ciphering files written into it as they are closed, until interrupted.\n"
+                "-jobs      In directory mode, the number of files ciphered at once, largest first (default: 1, number of CPUs with '-watch').\n"
+                "-progress  Reports bytes and files done, rate and time remaining on stderr every second.\n"
+                "-no-space-check  Starts even when the predicted output does not fit in the free space of its filesystem.\n\n"
+                "For more information, including documentation, please visit https://www.github.com/Th3Tr1ckst3r/Gaius\n\n");
+        return 1;
+    }
+
+    options.mode = argv[1];
+    const char *input_path = argv[3];
+    targets[0].keyword = argv[2];
+    targets[0].output_path = argv[4];
+
+    if (strcmp(options.mode, "encipher") != 0 && strcmp(options.mode, "decipher") != 0) {
+        fprintf(stderr, "Error: Invalid mode '%s'. Must be 'encipher' or 'decipher'.\n", options.mode);
+        return 1;
+    }
+    options.decipher = strcmp(options.mode, "decipher") == 0;
+
+    if (options.decipher && options.target_count > 1) {
+        fprintf(stderr, "Error: The '-key' flag can only be used when enciphering.\n");
+        return 1;
+    }
+
+    for (int t = 0; t < options.target_count; t++) {
+        if (!validate_password(targets[t].keyword)) {
+            fprintf(stderr, "Error: Password must be at least 8 characters long, contain at least 1 special character, and 1 integer.\n");
+            return 1;
+        }
+    }
+
+    if (options.line_mode) {
+        if (is_directory(input_path)) {
+            fprintf(stderr, "Error: Record mode works on a single file or stream, not a directory.\n");
+            return 1;
+        }
+    } else if (strcmp(input_path, "-") == 0) {
+        fprintf(stderr, "Error: Reading standard input requires '-lines', '-csv' or '-jsonl'.\n");
+        return 1;
+    }
+
+    if (strcmp(input_path, "-") != 0 && !is_directory(input_path) && access(input_path, F_OK) == -1) {
+        fprintf(stderr, "Error: Input path does not exist.\n");
+        return 1;
+    }
+
+    if (shard_count && !is_directory(input_path)) {
+        fprintf(stderr, "Error: The '-shard' flag requires a directory as input.\n");
+        return 1;
+    }
+    if (watch && !is_directory(input_path)) {
+        fprintf(stderr, "Error: The '-watch' flag requires a directory as input.\n");
+        return 1;
+    }
+#ifndef __linux__
+    if (watch) {
+        fprintf(stderr, "Error: The '-watch' flag is only supported on Linux.\n");
+        return 1;
+    }
+#endif
+
+    const char *output_paths[options.target_count];
+    for (int t = 0; t < options.target_count; t++) {
+        if (is_directory(targets[t].output_path)) {
+            create_directory(targets[t].output_path);
+        }
+        prepare_target(&targets[t], &options);
+        output_paths[t] = targets[t].output_path;
+    }
+
+    // In record mode standard output may be carrying the records
+    if (options.enable_verbosity && !options.line_mode) {
+        printf("Mode: %s\n", options.mode);
+        for (int t = 0; t < options.target_count; t++) {
+            printf("Keyword: %s\n", targets[t].keyword);
+        }
+        printf("Input Path: %s\n", input_path);
+        for (int t = 0; t < options.target_count; t++) {
+            printf("Output Path: %s\n", targets[t].output_path);
+        }
+        printf("Disable Base64: %s\n", options.disable_base64 ? "Yes" : "No");
+        printf("Checksums Enabled: %s\n", options.enable_crc ? "Yes" : "No");
+        printf("Raw Byte Mode: %s\n", options.enable_raw ? "Yes" : "No");
+        printf("Adaptive Base64: %s\n", options.enable_adaptive ? "Yes" : "No");
+        printf("Verbosity Enabled: Yes\n");
+        printf("Buffer Size: %zu bytes\n", options.buffer_size);
+        if (shard_count) {
+            printf("Shard: %d of %d%s\n", shard_index + 1, shard_count, shard_balance ? ", balanced by size" : "");
+        }
+    }
+
+    // Lower the priority before any work is done, so co-located services are never starved
+    if (set_nice && setpriority(PRIO_PROCESS, 0, nice_level) != 0) {
+        perror("Warning: Could not set nice level");
+    }
+#ifdef SYS_ioprio_set
+    if (idle_io && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0) {
+        perror("Warning: Could not set idle I/O class");
+    }
+#else
+    if (idle_io) {
+        fprintf(stderr, "Warning: Idle I/O class is not supported on this platform.\n");
+    }
+#endif
+    if (max_read_rate || max_write_rate || max_cpu) {
+        options.throttle = throttle_create(max_read_rate, max_write_rate, max_cpu);
+        if (!options.throttle) {
+            free(targets);
+            return 1;
+        }
+    }
+
+    // Streams are not journaled, there is nothing to resume them from
+    if (options.line_mode) {
+        int status = process_lines(&options, input_path, output_paths);
+        if (options.fields) {
+            free(options.fields->names[0]); // The copy of the list all names point into.
+            free(options.fields->names);
+            free(options.fields->columns);
+            free(options.fields);
+        }
+        free(targets);
+        return status == 0 ? 0 : 1;
+    }
+
+    if (shard_count) {
+        options.shard = shard_create(shard_index, shard_count, input_path, shard_balance);
+        if (!options.shard) {
+            free(options.throttle);
+            free(targets);
+            return 1;
+        }
+        if (options.enable_verbosity && shard_balance) {
+            printf("Shard plan: %zu files assigned to this shard.\n", options.shard->path_count);
+        }
+    }
+
+    // The journal lives beside the first output, and is removed once the run succeeds. A single file is only
+    // journaled with '-resume', and never beside a device or pipe like /dev/null or /dev/stdout.
+    struct stat journal_stat;
+    int journaled = (is_directory(input_path) || resume) &&
+                    (stat(output_paths[0], &journal_stat) != 0 || S_ISREG(journal_stat.st_mode) || S_ISDIR(journal_stat.st_mode));
+    if (resume && !journaled) {
+        fprintf(stderr, "Error: The '-resume' flag requires a regular file or directory as output.\n");
+    }
+    options.journal = journaled ? journal_open(&options, output_paths[0], resume) : NULL;
+    if (resume && !options.journal) {
+        if (options.shard) {
+            shard_free(options.shard);
+        }
+        free(options.throttle);
+        free(targets);
+        return 1;
+    }
+
+    int status = -1;
+    if (is_directory(input_path)) {
+        for (int t = 0; t < options.target_count; t++) {
+            create_directory(output_paths[t]);
+        }
+        if (watch) {
+#ifdef __linux__
+            status = watch_tree(&options, input_path, output_paths, options.jobs);
+#endif
+        } else {
+            status = process_directory(&options, input_path, output_paths);
+        }
+        if (options.dedup && options.enable_verbosity) {
+            printf("Deduplication: %zu hardlinks linked, %zu duplicates cloned.\n", options.dedup->linked, options.dedup->cloned);
+        }
+        if (options.dedup) {
+            dedup_free(options.dedup, options.decipher ? 1 : options.target_count);
+        }
+    } else {
+        struct stat input_stat;
+        struct preflight_file file = {(char *)input_path, 0, 0};
+        if (stat(input_path, &input_stat) == 0) {
+            file.size = input_stat.st_size;
+            file.allocated = (off_t)input_stat.st_blocks * 512;
+        }
+        if (!options.space_check || check_free_space(&options, output_paths, &file, 1) == 0) {
+            if (options.progress) {
+                progress_start(options.progress, file.size, 1);
+            }
+            status = process_file(&options, input_path, output_paths);
+            if (options.progress) {
+                progress.done_files = 1;
+                progress_finish(options.progress);
+            }
+        }
+    }
+
+    if (resume && options.enable_verbosity) {
+        printf("Resume: %zu completed files skipped, %zu files continued from a checkpoint.\n", options.journal->skipped, options.journal->resumed);
+    }
+    // A watch only ends when stopped, its journal stays for '-resume'
+    if (options.journal) {
+        journal_close(options.journal, status == 0 && !watch);
+    }
+    if (options.shard) {
+        shard_free(options.shard);
+    }
+    free(options.throttle);
+    free(targets);
+    return status == 0 ? 0 : 1;
 }
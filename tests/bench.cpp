@@ -0,0 +1,167 @@
+/*
+  Microbenchmark of gaius.hpp. Compares the fused Base64 paths of gaius::Cipher, where the substitution
+  is folded into the Base64 tables, with the staged equivalent that encodes or decodes Base64 and then
+  substitutes in a second pass, checking first that both produce the same bytes. The enciphered
+  buffer is written out so tests/bench.sh can compare it with, and time, the command line tool.
+
+  Usage: bench <keyword> <megabytes> <input_out> <enciphered_out>
+*/
+
+#include "../gaius.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t chunk_size = 4096; // The command line tool's default "-chunk".
+
+// Plain Base64, the first stage of the staged path.
+std::size_t base64_encode(const std::uint8_t *src, std::size_t len, std::uint8_t *dst) {
+    std::size_t i = 0, j = 0;
+    for (; i + 3 <= len; i += 3) {
+        std::uint32_t triple = (std::uint32_t{src[i]} << 16) | (std::uint32_t{src[i + 1]} << 8) | src[i + 2];
+        for (int shift = 18; shift >= 0; shift -= 6) dst[j++] = gaius::detail::b64_table[(triple >> shift) & 0x3F];
+    }
+    if (std::size_t rest = len - i) {
+        std::uint32_t triple = std::uint32_t{src[i]} << 16;
+        if (rest == 2) triple |= std::uint32_t{src[i + 1]} << 8;
+        dst[j++] = gaius::detail::b64_table[(triple >> 18) & 0x3F];
+        dst[j++] = gaius::detail::b64_table[(triple >> 12) & 0x3F];
+        dst[j++] = rest == 2 ? gaius::detail::b64_table[(triple >> 6) & 0x3F] : '=';
+        dst[j++] = '=';
+    }
+    return j;
+}
+
+// Plain Base64 decoding, the second stage of the staged decipher path.
+std::size_t base64_decode(const std::uint8_t *src, std::size_t len, std::uint8_t *dst) {
+    const auto &index = gaius::detail::b64_index;
+    std::size_t j = 0;
+    for (std::size_t i = 0; i + 4 <= len; i += 4) {
+        std::uint32_t quad = (std::uint32_t{index[src[i]]} << 18) | (std::uint32_t{index[src[i + 1]]} << 12) |
+                             (std::uint32_t{index[src[i + 2]]} << 6) | index[src[i + 3]];
+        dst[j++] = static_cast<std::uint8_t>(quad >> 16);
+        if (src[i + 2] != '=') dst[j++] = static_cast<std::uint8_t>(quad >> 8);
+        if (src[i + 3] != '=') dst[j++] = static_cast<std::uint8_t>(quad);
+    }
+    return j;
+}
+
+std::span<const std::byte> in_bytes(const std::uint8_t *data, std::size_t len) {
+    return {reinterpret_cast<const std::byte *>(data), len};
+}
+
+std::span<std::byte> out_bytes(std::uint8_t *data, std::size_t len) {
+    return {reinterpret_cast<std::byte *>(data), len};
+}
+
+// Runs one pass over the whole buffer until at least half a second has passed, returning MB/s of input.
+template <typename Pass>
+double throughput(std::size_t total, Pass pass) {
+    using clock = std::chrono::steady_clock;
+    int rounds = 0;
+    auto start = clock::now();
+    double seconds;
+    do {
+        pass();
+        rounds++;
+        seconds = std::chrono::duration<double>(clock::now() - start).count();
+    } while (seconds < 0.5);
+    return static_cast<double>(total) * rounds / seconds / 1e6;
+}
+
+bool write_file(const char *path, const std::vector<std::uint8_t> &data, std::size_t len) {
+    std::FILE *fp = std::fopen(path, "wb");
+    bool ok = fp && std::fwrite(data.data(), 1, len, fp) == len;
+    return fp && std::fclose(fp) == 0 && ok;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    if (argc != 5) {
+        std::fprintf(stderr, "Usage: bench <keyword> <megabytes> <input_out> <enciphered_out>\n");
+        return 2;
+    }
+    const char *keyword = argv[1];
+    std::size_t size = std::strtoul(argv[2], nullptr, 10) * 1024 * 1024;
+    std::size_t chunks = (size + chunk_size - 1) / chunk_size;
+    std::size_t cipher_chunk = gaius::Encipher::output_size(chunk_size);
+
+    std::vector<std::uint8_t> input(size), fused(chunks * cipher_chunk), staged(fused.size()), scratch(cipher_chunk);
+    std::vector<std::uint8_t> plain(size + 3); // output_size() counts the padding of the last group as data.
+    std::mt19937_64 random(42);
+    for (auto &byte : input) byte = static_cast<std::uint8_t>(random());
+
+    const gaius::Encipher encipher(keyword);
+    const gaius::EncipherN64 substitute(keyword);
+    const gaius::Decipher decipher(keyword);
+    const gaius::DecipherN64 unsubstitute(keyword);
+
+    std::size_t fused_length = 0, staged_length = 0, plain_length = 0;
+    auto fused_encipher = [&] {
+        fused_length = 0;
+        for (std::size_t at = 0; at < size; at += chunk_size) {
+            std::size_t len = std::min(chunk_size, size - at);
+            fused_length += encipher.process(in_bytes(&input[at], len), out_bytes(&fused[fused_length], cipher_chunk));
+        }
+    };
+    auto staged_encipher = [&] {
+        staged_length = 0;
+        for (std::size_t at = 0; at < size; at += chunk_size) {
+            std::size_t len = std::min(chunk_size, size - at);
+            std::size_t encoded = base64_encode(&input[at], len, scratch.data());
+            staged_length += substitute.process(in_bytes(scratch.data(), encoded), out_bytes(&staged[staged_length], encoded));
+        }
+    };
+    auto fused_decipher = [&] {
+        plain_length = 0;
+        for (std::size_t at = 0; at < fused_length; at += cipher_chunk) {
+            std::size_t len = std::min(cipher_chunk, fused_length - at);
+            plain_length += decipher.process(in_bytes(&fused[at], len), out_bytes(&plain[plain_length], gaius::Decipher::output_size(len)));
+        }
+    };
+    auto staged_decipher = [&] {
+        plain_length = 0;
+        for (std::size_t at = 0; at < fused_length; at += cipher_chunk) {
+            std::size_t len = std::min(cipher_chunk, fused_length - at);
+            unsubstitute.process(in_bytes(&fused[at], len), out_bytes(scratch.data(), len));
+            plain_length += base64_decode(scratch.data(), len, &plain[plain_length]);
+        }
+    };
+
+    // Both paths must agree before their speed means anything
+    fused_encipher();
+    staged_encipher();
+    if (fused_length != staged_length || std::memcmp(fused.data(), staged.data(), fused_length) != 0) {
+        std::fprintf(stderr, "FAIL: fused and staged encipher differ\n");
+        return 1;
+    }
+    fused_decipher();
+    if (plain_length != size || std::memcmp(plain.data(), input.data(), size) != 0) {
+        std::fprintf(stderr, "FAIL: fused decipher does not round trip\n");
+        return 1;
+    }
+    staged_decipher();
+    if (plain_length != size || std::memcmp(plain.data(), input.data(), size) != 0) {
+        std::fprintf(stderr, "FAIL: staged decipher does not round trip\n");
+        return 1;
+    }
+
+    std::printf("encipher fused  %8.1f MB/s\n", throughput(size, fused_encipher));
+    std::printf("encipher staged %8.1f MB/s\n", throughput(size, staged_encipher));
+    std::printf("decipher fused  %8.1f MB/s\n", throughput(size, fused_decipher));
+    std::printf("decipher staged %8.1f MB/s\n", throughput(size, staged_decipher));
+
+    if (!write_file(argv[3], input, size) || !write_file(argv[4], fused, fused_length)) {
+        std::perror("Error writing benchmark output");
+        return 1;
+    }
+    return 0;
+}
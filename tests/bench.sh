@@ -0,0 +1,37 @@
+#!/bin/sh
+# Throughput of the fused and staged Base64 paths of gaius.hpp, checked against each other and against the
+# command line tool, which is timed on the same data for comparison.
+#
+# Usage: tests/bench.sh [megabytes]   (default 256)
+# Needs a C++20 compiler. Files go to $TMPDIR, preferably a tmpfs so the tool's timing is not disk bound.
+
+set -eu
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d "${TMPDIR:-/tmp}/gaius-bench.XXXXXX")
+trap 'rm -rf "$work"' EXIT INT TERM
+key='pass#word1'
+megabytes=${1:-256}
+
+${CXX:-g++} -std=c++20 -O2 "$root/tests/bench.cpp" -o "$work/bench"
+${CC:-gcc} -O2 -pthread "$root/gaius_v1.1.c" -o "$work/gaius" -lm
+
+"$work/bench" "$key" "$megabytes" "$work/input" "$work/expected"
+
+# The header's output must be the tool's output, or the numbers compare different work
+"$work/gaius" encipher "$key" "$work/input" "$work/enciphered"
+if ! cmp "$work/expected" "$work/enciphered"; then
+    echo "FAIL: gaius.hpp and gaius_v1.1.c encipher differently" >&2
+    exit 1
+fi
+
+start=$(date +%s%N)
+"$work/gaius" encipher "$key" "$work/input" "$work/enciphered"
+end=$(date +%s%N)
+echo "$megabytes $start $end" | awk '{ printf "encipher tool   %8.1f MB/s (file to file)\n", $1 * 1048576 / (($3 - $2) / 1000) }'
+
+start=$(date +%s%N)
+"$work/gaius" decipher "$key" "$work/enciphered" "$work/deciphered"
+end=$(date +%s%N)
+echo "$megabytes $start $end" | awk '{ printf "decipher tool   %8.1f MB/s (file to file)\n", $1 * 1048576 / (($3 - $2) / 1000) }'
+cmp "$work/input" "$work/deciphered"
@@ -0,0 +1,121 @@
+/*
+  Host-side test of gaius_core.h. Ciphers standard input to standard output through the core, the
+  way an embedded caller would: the work area is a static struct gaius_core, input is pushed in
+  pieces of 1 to 7 bytes and then of 61, and I/O is plain read() and write(). Any use of the heap
+  aborts the run, and the stack used below the push and finish calls is measured from inside the
+  sink. tests/core_test.sh runs it under a memory cap and compares its output with the tool's.
+
+  Usage: core_test <encipher|decipher> <keyword> <chunk> [-n64|-raw] < input > output
+*/
+
+#include "../gaius_core.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define STACK_LIMIT 512 // Bytes below the caller for the core and the sink together.
+
+static struct gaius_core core;
+static const char *stack_base;
+static size_t stack_used;
+static int armed;
+
+// Function to write a message to stderr without stdio, which would allocate.
+static void say(const char *text) {
+    ssize_t ignored = write(2, text, strlen(text));
+    (void)ignored;
+}
+
+// The heap is off limits once the core is in use.
+static void heap_used(void) {
+    say("FAIL: the core used the heap\n");
+    _exit(1);
+}
+
+void *malloc(size_t size) { (void)size; if (armed) heap_used(); return NULL; }
+void *calloc(size_t count, size_t size) { (void)count; (void)size; if (armed) heap_used(); return NULL; }
+void *realloc(void *pointer, size_t size) { (void)pointer; (void)size; if (armed) heap_used(); return NULL; }
+void free(void *pointer) { if (pointer) heap_used(); }
+
+// Function to receive output, measuring how deep below the caller it runs.
+static void sink(void *context, const unsigned char *data, size_t length) {
+    char here;
+    size_t depth = (size_t)(stack_base - &here);
+    (void)context;
+    if (depth > stack_used) {
+        stack_used = depth;
+    }
+    while (length > 0) {
+        ssize_t n = write(1, data, length);
+        if (n <= 0) {
+            say("FAIL: write\n");
+            _exit(1);
+        }
+        data += n;
+        length -= (size_t)n;
+    }
+}
+
+// Function to print a number without stdio.
+static void say_number(size_t value) {
+    char text[24];
+    int at = sizeof(text);
+    do {
+        text[--at] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    ssize_t ignored = write(2, text + at, sizeof(text) - at);
+    (void)ignored;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int flags = 0;
+    unsigned char input[256];
+    char base;
+    size_t piece = 0;
+
+    if (argc < 4 || argc > 5) {
+        say("Usage: core_test <encipher|decipher> <keyword> <chunk> [-n64|-raw] < input > output\n");
+        return 2;
+    }
+    if (strcmp(argv[1], "decipher") == 0) {
+        flags |= GAIUS_CORE_DECIPHER;
+    }
+    if (argc == 5) {
+        flags |= strcmp(argv[4], "-raw") == 0 ? GAIUS_CORE_RAW : GAIUS_CORE_NO_BASE64;
+    }
+    stack_base = &base;
+    armed = 1;
+
+    if (gaius_core_init(&core, argv[2], flags, (uint32_t)strtoul(argv[3], NULL, 10), sink, NULL) != 0) {
+        say("FAIL: gaius_core_init\n");
+        return 1;
+    }
+    for (;;) {
+        // Odd piece sizes, so groups and chunks are split everywhere
+        size_t want = piece < 64 ? piece % 7 + 1 : 61;
+        ssize_t n = read(0, input, want);
+        if (n < 0) {
+            say("FAIL: read\n");
+            return 1;
+        }
+        if (n == 0) {
+            break;
+        }
+        gaius_core_push(&core, input, (size_t)n);
+        piece++;
+    }
+    gaius_core_finish(&core);
+
+    say("work area ");
+    say_number(sizeof(core));
+    say(" bytes, stack ");
+    say_number(stack_used);
+    say(" bytes\n");
+    if (stack_used > STACK_LIMIT) {
+        say("FAIL: stack use above the limit\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+#!/bin/sh
+# Runs gaius_core.h under a strict memory cap, 8 MB of address space and 64 KB of stack with the heap
+# trapped, and checks its output against the command line tool for every mode it supports, in both
+# directions and at two chunk sizes. Also reports the core's code size next to the documented 1.4 KB.
+#
+# Usage: tests/core_test.sh
+
+set -eu
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d "${TMPDIR:-/tmp}/gaius-core.XXXXXX")
+trap 'rm -rf "$work"' EXIT INT TERM
+key='pass#word1'
+
+${CC:-gcc} -O2 -pthread "$root/gaius_v1.1.c" -o "$work/gaius" -lm
+${CC:-gcc} -Os -Wall "$root/tests/core_test.c" -o "$work/core_test"
+
+# Code size of init, push and finish alone, as the header documents it
+cat > "$work/size.c" <<EOF
+#include "$root/gaius_core.h"
+int init(struct gaius_core *c, const char *k, unsigned f, uint32_t s, gaius_core_sink o, void *x) { return gaius_core_init(c, k, f, s, o, x); }
+void push(struct gaius_core *c, const unsigned char *d, size_t n) { gaius_core_push(c, d, n); }
+void finish(struct gaius_core *c) { gaius_core_finish(c); }
+EOF
+${CC:-gcc} -Os -c "$work/size.c" -o "$work/size.o"
+text=$(size -A "$work/size.o" | awk '$1 == ".text" { print $2 }')
+echo "core code size: $text bytes of text"
+if [ "$text" -gt 2048 ]; then
+    echo "FAIL: core code size above 2 KB" >&2
+    exit 1
+fi
+
+# Random bytes, then text, so letters, digits, punctuation and every byte value all occur
+head -c 30000 /dev/urandom > "$work/input"
+yes 'The quick brown fox, 1 lazy dog! {"json": true}' | head -c 20000 >> "$work/input"
+head -c 777 /dev/urandom >> "$work/input"
+
+capped() {
+    (ulimit -v 8192 && ulimit -s 64 && exec "$work/core_test" "$@")
+}
+
+for chunk in 4096 1024; do
+    for mode in "" -n64 -raw; do
+        name="chunk $chunk${mode:+ $mode}"
+        "$work/gaius" encipher "$key" "$work/input" "$work/tool" -chunk "$chunk" $mode
+        capped encipher "$key" "$chunk" $mode < "$work/input" > "$work/core" 2> "$work/log"
+        if ! cmp -s "$work/tool" "$work/core"; then
+            cat "$work/log" >&2
+            echo "FAIL: $name: core encipher differs from the tool" >&2
+            exit 1
+        fi
+        capped decipher "$key" "$chunk" $mode < "$work/tool" > "$work/plain" 2>> "$work/log"
+        if ! cmp -s "$work/input" "$work/plain"; then
+            cat "$work/log" >&2
+            echo "FAIL: $name: core decipher does not restore the input" >&2
+            exit 1
+        fi
+        echo "ok: $name, $(tail -n 1 "$work/log")"
+    done
+done